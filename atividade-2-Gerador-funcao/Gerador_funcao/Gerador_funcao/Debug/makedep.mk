@@ -4,3 +4,37 @@
 
 main.c
 
+dds.c
+
+dds_isr.s
+
+awg.c
+
+stream.c
+
+uart.c
+
+status.c
+
+cmd.c
+
+proto.c
+
+adc.c
+
+sweep.c
+
+mod.c
+
+seq.c
+
+pulse.c
+
+fast.c
+
+fast_loop.s
+
+event.c
+
+dac.c
+
@@ -0,0 +1,120 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   adc.c
+   @brief  Frequency pot reading, see adc.h.
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include <stdint.h>
+
+#include "event.h"
+
+#include "adc.h"
+
+#if ADC_MAX << ADC_FRAC > 0x7fff
+#error "The filter state must fit an int16_t"
+#endif
+
+/*--------- Globals ---------*/
+
+static uint16_t sum = 0;       // Conversions summed so far
+static uint8_t count = 0;      // Conversions in sum
+static int16_t filtered;       // IIR output, ADC_FRAC fractional bits
+static uint8_t primed = 0;     // 0 before the first sample, 1 until it is published
+
+static volatile uint16_t value = 0; // Published value
+static volatile uint8_t changed = 0;
+
+/*--------- Function definition ---------*/
+/**
+   Start the ADC free running on channel (ADC0-7), referenced to AVCC.
+*/
+void adc_init(uint8_t channel)
+{
+    ADMUX = (1 << REFS0) | (channel & 0x07); // Vref = pin AVCC (5V)
+    ADCSRB = 0x00; // Auto trigger source: free running
+    DIDR0 = channel < 6 ? 1 << channel : 0; // ADC6-7 have no digital buffer
+    // Enable, start, auto trigger, interrupt, prescaler 128
+    ADCSRA = (1 << ADEN) | (1 << ADSC) | (1 << ADATE) | (1 << ADIE) | 0x07;
+}
+
+/**
+   The last value published, returns 0 if it did not change since the last
+   call.
+*/
+uint8_t adc_get(uint16_t * v)
+{
+    uint8_t r;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        r = changed;
+        changed = 0;
+        *v = value;
+    }
+    return r;
+}
+
+/*--------- Interrupts ---------*/
+/**
+   Conversion complete. ADIF is cleared on entry and the next conversion
+   takes 1664 cycles, so it is safe to let the sample ISR in.
+*/
+ISR(ADC_vect, ISR_NOBLOCK)
+{
+    sum += ADCW;
+    if(++count < ADC_OVERSAMPLE) {
+        return;
+    }
+    int16_t x = (sum >> ADC_DECIMATE) << ADC_FRAC;
+    sum = 0;
+    count = 0;
+
+    if(!primed) {
+        filtered = x; // Start from the first reading, not from 0
+        primed = 1;
+    } else {
+        filtered += (x - filtered) >> ADC_IIR_SHIFT;
+    }
+
+    uint16_t y = (filtered + (1 << (ADC_FRAC - 1))) >> ADC_FRAC; // Rounded
+    // Snap to the ends, so the whole range is reachable through the deadband
+    if(y <= ADC_HYST) {
+        y = 0;
+    } else if(y >= ADC_MAX - ADC_HYST) {
+        y = ADC_MAX;
+    }
+    uint16_t v = value;
+    // Past the deadband, at an end or the first sample
+    if(y > v + ADC_HYST || v > y + ADC_HYST ||
+       (y != v && (y == 0 || y == ADC_MAX)) || primed == 1) {
+        value = y;
+        changed = 1;
+        primed = 2;
+        event_post(EVENT_POT);
+    }
+}
+
+/*--------- EOF ---------*/
@@ -0,0 +1,63 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   adc.h
+   @brief  Frequency pot reading, filtered in the ADC interrupt.
+
+   The ADC runs free, one conversion every 13 ADC clocks (4808/s at
+   8 MHz / 128), and the conversion complete ISR does the rest:
+
+     - ADC_OVERSAMPLE conversions are summed and decimated to one 12 bit
+       sample (300/s), which averages out the LSB noise;
+     - a first order IIR low pass, y += (x - y)/2^ADC_IIR_SHIFT, kept with
+       ADC_FRAC extra bits so small steps are not lost to rounding;
+     - hysteresis: the published value only moves when the filtered one is
+       more than ADC_HYST away from it, so a pot sitting between two codes
+       does not flip between them.
+
+   The main loop only sees a new value when it actually changed, see
+   adc_get(), and is woken up for it (EVENT_POT, event.h).
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __ADC_H__
+#define __ADC_H__
+
+/*--- Includes ---*/
+
+#include <stdint.h>
+
+/*--- Constants ---*/
+
+#define ADC_OVERSAMPLE (16) /*!< Conversions per sample, 4^n for n more bits */
+#define ADC_DECIMATE   (2)  /*!< Sum shifted right, log2(ADC_OVERSAMPLE)/2 */
+#define ADC_MAX        ((1023UL*ADC_OVERSAMPLE) >> ADC_DECIMATE) /*!< Full scale, 4092 */
+#define ADC_IIR_SHIFT  (2)  /*!< Filter time constant, in samples (2^n) */
+#define ADC_FRAC       (3)  /*!< Extra bits kept in the filter */
+#define ADC_HYST       (3)  /*!< Published value deadband, in LSB */
+
+/*--------- Prototype dec ---------*/
+
+void adc_init(uint8_t channel);
+uint8_t adc_get(uint16_t * value);
+
+#endif /* __ADC_H__ */
+
+/*--------- EOF ---------*/
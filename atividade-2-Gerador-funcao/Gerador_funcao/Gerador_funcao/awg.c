@@ -0,0 +1,209 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   awg.c
+   @brief  Arbitrary waveform (AWG) upload over the uart, see awg.h.
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include "dds.h"
+#include "wavetables.h"
+
+#include "awg.h"
+
+#if WAVE_LEN > 256
+#error "The two AWG buffers would not fit the 2 KB of SRAM, build the tables with at most 256 points"
+#endif
+
+/*--------- Types ---------*/
+
+typedef enum awgRxState {
+    RX_IDLE = 0, /*!< Waiting for AWG_SOF, other bytes are text */
+    RX_LEN0,
+    RX_LEN1,
+    RX_DATA,
+    RX_CRC0,
+    RX_CRC1,
+    RX_SKIP      /*!< Bad frame, eat bytes until the line goes quiet */
+} awgRxState_t;
+
+/*--------- Globals ---------*/
+
+static uint8_t awg_buff[2][WAVE_LEN + 1]; // Front and back waveform, + guard point, 8 bits whatever WAVE_BITS
+static uint8_t awg_front = 0; // Buffer last received
+static volatile uint8_t awg_new = 0; // awg_front not given to the DDS engine yet, see awg_poll()
+static volatile uint8_t awg_loaded = 0; // A waveform was received, awg_init() only fills in the DAC zero
+
+/*------ Receiver ------*/
+static awgRxState_t rx_state = RX_IDLE;
+static uint16_t rx_len;
+static uint16_t rx_pos;
+static uint16_t rx_crc; // Computed so far
+static uint16_t rx_crc_frame; // Sent in the frame
+static awgResult_t rx_drop; // Why the frame is not being stored, if not
+static volatile uint8_t rx_idle = 0; // awg_tick() calls since the last byte
+
+static volatile awgResult_t result = AWG_NONE;
+
+/*--------- Function definition ---------*/
+/**
+   Fill both buffers with the DAC zero and hand the front one to the DDS
+   engine.
+*/
+void awg_init(void)
+{
+    memset(awg_buff, 127, sizeof(awg_buff));
+    dds_set_awg(awg_buff[awg_front]);
+}
+
+/**
+   Feed a received byte to the frame receiver, from the uart RX ISR.
+   Returns 0 if the byte is not part of a frame (text command).
+*/
+uint8_t awg_rx(uint8_t c)
+{
+    uint8_t back = !awg_front;
+
+    rx_idle = 0;
+
+    switch(rx_state) {
+    case RX_IDLE:
+        if(c != AWG_SOF) {
+            return 0;
+        }
+        rx_crc = 0xffff;
+        rx_state = RX_LEN0;
+        break;
+    case RX_LEN0:
+        rx_crc = _crc_xmodem_update(rx_crc, c);
+        rx_len = c;
+        rx_state = RX_LEN1;
+        break;
+    case RX_LEN1:
+        rx_crc = _crc_xmodem_update(rx_crc, c);
+        rx_len |= (uint16_t)c << 8;
+        rx_pos = 0;
+        rx_drop = AWG_NONE;
+        if(rx_len != WAVE_LEN) {
+            result = AWG_BAD_LEN;
+            rx_state = RX_SKIP; // Can not trust the length to skip the frame
+            break;
+        }
+        if(awg_new || dds_awg_pending() || dds_awg_in_use(awg_buff[back])) {
+            rx_drop = AWG_BUSY; // The back buffer is still playing, maybe as a list step
+        }
+        rx_state = RX_DATA;
+        break;
+    case RX_DATA:
+        rx_crc = _crc_xmodem_update(rx_crc, c);
+        if(rx_drop == AWG_NONE) {
+            awg_buff[back][rx_pos] = c;
+        }
+        if(++rx_pos >= rx_len) {
+            rx_state = RX_CRC0;
+        }
+        break;
+    case RX_CRC0:
+        rx_crc_frame = c;
+        rx_state = RX_CRC1;
+        break;
+    case RX_CRC1:
+        rx_crc_frame |= (uint16_t)c << 8;
+        rx_state = RX_IDLE;
+        if(rx_drop != AWG_NONE) {
+            result = rx_drop;
+        } else if(rx_crc_frame != rx_crc) {
+            result = AWG_BAD_CRC;
+        } else {
+            awg_buff[back][WAVE_LEN] = awg_buff[back][0]; // Guard point
+            awg_front = back;
+            awg_new = 1;
+            awg_loaded = 1;
+            result = AWG_OK;
+        }
+        break;
+    case RX_SKIP:
+        break;
+    }
+    return 1;
+}
+
+/**
+   Give a waveform just received to the DDS engine, from the main loop
+   (the DDS parameters are only ever set there, see dds_set_awg()).
+*/
+void awg_poll(void)
+{
+    if(awg_new) {
+        dds_set_awg(awg_buff[awg_front]);
+        awg_new = 0; // Only now, dds_awg_pending() holds off the next upload
+    }
+}
+
+/**
+   Frame timeout, to be called periodically (Timer0 overflow). A frame that
+   stops for AWG_TIMEOUT ticks is dropped, so a host that gives up half way
+   does not leave the text commands stuck.
+*/
+void awg_tick(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if(rx_idle < AWG_TIMEOUT) {
+            ++rx_idle;
+        } else if(rx_state != RX_IDLE) {
+            if(rx_state != RX_SKIP) {
+                result = AWG_TIMED_OUT;
+            }
+            rx_state = RX_IDLE;
+        }
+    }
+}
+
+/**
+   Whether a waveform has been uploaded, so WAVE_AWG has something to play.
+*/
+uint8_t awg_ready(void)
+{
+    return awg_loaded;
+}
+
+/**
+   Outcome of the last frame, AWG_NONE if already read.
+*/
+awgResult_t awg_result(void)
+{
+    awgResult_t r;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        r = result;
+        result = AWG_NONE;
+    }
+    return r;
+}
+
+/*--------- EOF ---------*/
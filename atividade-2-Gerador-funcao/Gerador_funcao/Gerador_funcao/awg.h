@@ -0,0 +1,77 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   awg.h
+   @brief  Arbitrary waveform (AWG) upload over the uart.
+
+   The waveform played as WAVE_AWG lives in RAM and is uploaded as a binary
+   frame, mixed with the text commands on the same uart:
+
+       AWG_SOF | len (2 bytes) | len samples | crc (2 bytes)
+
+   Multi-byte fields are little endian. len must be WAVE_LEN (see
+   wavetables.h) and the crc is CRC-16/CCITT-FALSE (poly 0x1021, init
+   0xffff) of the len bytes and the samples.
+
+   There are two buffers: the upload fills the back one while the sample
+   ISR keeps playing the front one, and they are swapped at the start of the
+   next period (see dds_set_awg(), called from the main loop by awg_poll()).
+   A new upload is refused while a swap is still pending, or while a list
+   step (see seq.h) still plays or has queued the back buffer.
+   The buffers take 2 * (WAVE_LEN + 1) bytes of RAM, so WAVE_LEN is at most
+   256 (514 bytes).
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __AWG_H__
+#define __AWG_H__
+
+/*--- Includes ---*/
+
+#include <stdint.h>
+
+/*--- Constants ---*/
+
+#define AWG_SOF     (0x02) /*!< Start of frame (ASCII STX), never in a text command */
+#define AWG_TIMEOUT (25)   /*!< awg_tick() calls without a byte before a frame is dropped */
+
+/*--------- Types ---------*/
+
+typedef enum awgResult {
+    AWG_NONE = 0,  /*!< Nothing new */
+    AWG_OK,        /*!< Waveform received, playing from the next period */
+    AWG_BAD_LEN,   /*!< Frame length is not WAVE_LEN, dropped */
+    AWG_BAD_CRC,   /*!< Frame corrupted, dropped */
+    AWG_BUSY,      /*!< Previous waveform not swapped in yet, or the back one in use, dropped */
+    AWG_TIMED_OUT  /*!< Frame not finished in time, dropped */
+} awgResult_t;
+
+/*--------- Prototype dec ---------*/
+
+void awg_init(void);
+uint8_t awg_rx(uint8_t c);
+void awg_poll(void);
+void awg_tick(void);
+awgResult_t awg_result(void);
+uint8_t awg_ready(void);
+
+#endif /* __AWG_H__ */
+
+/*--------- EOF ---------*/
@@ -0,0 +1,310 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   cmd.c
+   @brief  Text command parser, see cmd.h.
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include <stdint.h>
+
+#include "cmd.h"
+#include "dds.h"
+#include "sweep.h"
+#include "mod.h"
+#include "seq.h"
+
+#if CMD_QUEUE_LEN & (CMD_QUEUE_LEN - 1)
+#error "CMD_QUEUE_LEN must be a power of 2"
+#endif
+
+/*--------- Types ---------*/
+
+typedef enum rxState {
+    RX_CMD = 0, /*!< Waiting for the command letter */
+    RX_FIELD,   /*!< Between fields */
+    RX_NUM,     /*!< Inside a number */
+    RX_ERROR,   /*!< Error found, skip to the end of the line */
+} rxState_t;
+
+typedef enum field {
+    FIELD_NONE = 0,   /*!< No more fields */
+    FIELD_LETTER = 'l', /*!< Checked by cmd_letter_valid() */
+    FIELD_NUM  = 'n', /*!< Decimal, 0-65535 */
+} field_t;
+
+/*--------- Globals ---------*/
+/*
+  The parser state is only touched by the RX ISR, the queue indexes by the
+  RX ISR (head) and cmd_get() (tail).
+*/
+static rxState_t state = RX_CMD;
+static command_t cur; // Command being parsed
+static uint8_t nums; // Numbers in cur so far
+
+static command_t queue[CMD_QUEUE_LEN];
+static volatile uint8_t q_head = 0;
+static volatile uint8_t q_tail = 0;
+static volatile uint8_t dropped = 0;
+
+static char echo[CMD_ECHO_LEN + 1];
+static uint8_t echo_len = 0;
+
+/*--------- Function definition ---------*/
+/**
+   Type of the next field of a command. The fields of each command are
+   spelled out as a string of field_t, c->field never goes past its end.
+*/
+static field_t field_type(const command_t * c)
+{
+    const char * fields;
+    switch(c->cmd) {
+    case CMD_CFG:
+        fields = c->letter == WAVE_PULSE ? "lnn" : "ln"; // + duty
+        break;
+    case CMD_STRM:
+    case CMD_FAST:
+        fields = "n";
+        break;
+    case CMD_SWEEP:
+        fields = "lnnn";
+        break;
+    case CMD_AMPL:
+        fields = "nn";
+        break;
+    case CMD_MOD:
+        fields = c->letter == MOD_OFF ? "l" : "lnn";
+        break;
+    case CMD_LIST:
+        fields = c->letter && !cmd_wave_valid(c->letter) ? "l" : "lnn";
+        break;
+    default:
+        fields = "";
+        break;
+    }
+    return fields[c->field];
+}
+
+static uint8_t is_cmd(uint8_t c)
+{
+    return c == CMD_STOP || c == CMD_RUN || c == CMD_CFG ||
+        c == CMD_INTP || c == CMD_STRM || c == CMD_HLP || c == CMD_SWEEP ||
+        c == CMD_AMPL || c == CMD_MOD || c == CMD_TRIG || c == CMD_LIST ||
+        c == CMD_FAST;
+}
+
+/**
+   Whether c is a waveType_t a command can select.
+*/
+uint8_t cmd_wave_valid(uint8_t c)
+{
+    return c == WAVE_SINE || c == WAVE_SQRE || c == WAVE_SWTT ||
+        c == WAVE_TRGL || c == WAVE_AWG || c == WAVE_WHITE || c == WAVE_PINK ||
+        c == WAVE_PULSE;
+}
+
+/**
+   Whether c is a letter the letter field of cmd takes.
+*/
+uint8_t cmd_letter_valid(cmd_t cmd, uint8_t c)
+{
+    switch(cmd) {
+    case CMD_CFG:
+        return cmd_wave_valid(c);
+    case CMD_SWEEP:
+        return c == SWEEP_LIN || c == SWEEP_LOG;
+    case CMD_MOD:
+        return c == MOD_OFF || c == MOD_AM || c == MOD_FM || c == MOD_BURST;
+    case CMD_LIST:
+        return (cmd_wave_valid(c) && c != WAVE_PULSE) || // Steps are DDS waves
+            c == SEQ_ONCE || c == SEQ_LOOP || c == SEQ_END || c == SEQ_CLEAR;
+    default:
+        return 0;
+    }
+}
+
+static void error(cmdErr_t err, uint8_t c)
+{
+    cur.err = err;
+    cur.bad = c;
+    state = RX_ERROR;
+}
+
+/**
+   Queue the command just parsed, or count it as dropped if the main loop
+   is that far behind.
+*/
+static void push(void)
+{
+    uint8_t next = (q_head + 1) & (CMD_QUEUE_LEN - 1);
+    if(next == q_tail) {
+        ++dropped;
+    } else {
+        queue[q_head] = cur;
+        q_head = next;
+    }
+}
+
+/**
+   End of line, check the fields are all there and queue the command.
+*/
+static void end_line(void)
+{
+    if(state == RX_NUM) {
+        ++cur.field;
+    } else if(state == RX_CMD) {
+        return; // Empty line
+    }
+    if(state != RX_ERROR && field_type(&cur) != FIELD_NONE) {
+        cur.err = CMD_ERR_MISSING;
+    }
+    push();
+}
+
+/**
+   Feed a received byte, from the uart RX ISR.
+*/
+void cmd_rx(uint8_t c)
+{
+    field_t type;
+
+    if(c == '\r' || c == '\n') {
+        end_line();
+        state = RX_CMD;
+        echo_len = 0;
+        echo[0] = 0;
+        return;
+    }
+    if(c < ' ' || c > '~') {
+        return; // Other control characters and 8 bit garbage
+    }
+
+    if(echo_len < CMD_ECHO_LEN) {
+        echo[echo_len + 1] = 0; // Terminate first, the status line may be reading it
+        echo[echo_len++] = c;
+    }
+
+    switch(state) {
+    case RX_CMD:
+        if(c == ' ') {
+            break; // Leading spaces
+        }
+        cur.cmd = c;
+        cur.err = CMD_OK;
+        cur.field = 0;
+        cur.bad = 0;
+        cur.letter = 0;
+        nums = 0;
+        state = RX_FIELD;
+        if(!is_cmd(c)) {
+            error(CMD_ERR_CMD, c);
+        }
+        break;
+    case RX_FIELD:
+        if(c == ' ') {
+            break;
+        }
+        type = field_type(&cur);
+        switch(type) {
+        case FIELD_NONE:
+            error(CMD_ERR_EXTRA, c);
+            break;
+        case FIELD_LETTER:
+            if(cmd_letter_valid(cur.cmd, c)) {
+                cur.letter = c;
+                ++cur.field;
+            } else {
+                error(CMD_ERR_LETTER, c);
+            }
+            break;
+        case FIELD_NUM:
+            if(c >= '0' && c <= '9') {
+                cur.num[nums] = c - '0';
+                state = RX_NUM;
+            } else {
+                error(CMD_ERR_NUM, c);
+            }
+            break;
+        }
+        break;
+    case RX_NUM:
+        if(c >= '0' && c <= '9') {
+            uint8_t d = c - '0';
+            if(cur.num[nums] > (UINT16_MAX - d)/10) {
+                error(CMD_ERR_RANGE, c);
+            } else {
+                cur.num[nums] = cur.num[nums]*10 + d;
+            }
+        } else if(c == ' ') {
+            ++nums;
+            ++cur.field;
+            state = RX_FIELD;
+        } else {
+            error(CMD_ERR_NUM, c);
+        }
+        break;
+    case RX_ERROR:
+        break;
+    }
+}
+
+/**
+   Take the oldest parsed command, returns 0 if there is none.
+*/
+uint8_t cmd_get(command_t * cmd)
+{
+    uint8_t r = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if(q_tail != q_head) {
+            *cmd = queue[q_tail];
+            q_tail = (q_tail + 1) & (CMD_QUEUE_LEN - 1);
+            r = 1;
+        }
+    }
+    return r;
+}
+
+/**
+   Lines lost to a full queue since the last call.
+*/
+uint8_t cmd_dropped(void)
+{
+    uint8_t r;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        r = dropped;
+        dropped = 0;
+    }
+    return r;
+}
+
+/**
+   The line being typed, for the status line.
+*/
+const char * cmd_echo(void)
+{
+    return echo;
+}
+
+/*--------- EOF ---------*/
@@ -0,0 +1,103 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   cmd.h
+   @brief  Text command parser, fed one byte at a time from the uart RX ISR.
+
+   Commands are a letter followed by its fields, separated by spaces and
+   ended by '\r' (or '\n'):
+
+       h | r | s | i | c <wave> <freq> | c u <freq> <duty> | x <rate>
+     | w <law> <start> <stop> <ms> | f <freq>
+
+   The parser is a state machine that looks at each byte once as it
+   arrives, so there is no line buffer to overflow and the work per byte is
+   bounded. Each line ends up as a command_t in a short queue, read by the
+   main loop with cmd_get(): either a well formed command or the first
+   error found, with the field it was found in. Range checks that depend on
+   the generator (frequency limits, etc.) are left to the caller.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __CMD_H__
+#define __CMD_H__
+
+/*--- Includes ---*/
+
+#include <stdint.h>
+
+#include "status.h"
+
+/*--- Constants ---*/
+
+#define CMD_MAX_NUMS  (3) /*!< Numeric fields in a command */
+#define CMD_QUEUE_LEN (4) /*!< Commands parsed but not handled yet, power of 2 */
+#define CMD_ECHO_LEN  (STATUS_CMD_LEN) /*!< Characters of the current line kept for the status line */
+
+/*--------- Types ---------*/
+
+typedef enum cmd {
+    CMD_STOP = 's',
+    CMD_RUN  = 'r',
+    CMD_CFG  = 'c',
+    CMD_INTP = 'i',
+    CMD_STRM = 'x',
+    CMD_HLP  = 'h',
+    CMD_SWEEP = 'w',
+    CMD_AMPL = 'a',
+    CMD_MOD  = 'm',
+    CMD_TRIG = 't',
+    CMD_LIST = 'l',
+    CMD_FAST = 'f',
+    CMD_QUERY = '?'  /*!< Binary protocol only, see proto.h */
+} cmd_t;
+
+typedef enum cmdErr {
+    CMD_OK = 0,
+    CMD_ERR_CMD,     /*!< Unknown command letter */
+    CMD_ERR_LETTER,  /*!< Not one of the letters the field takes */
+    CMD_ERR_NUM,     /*!< Not a number */
+    CMD_ERR_RANGE,   /*!< Number over 65535, or out of the generator range */
+    CMD_ERR_MISSING, /*!< Line ended before this field */
+    CMD_ERR_EXTRA,   /*!< Field after the last one */
+    CMD_ERR_STATE,   /*!< Not in the current mode */
+} cmdErr_t;
+
+typedef struct command {
+    cmd_t cmd;
+    cmdErr_t err;
+    uint8_t field;  /*!< Field the error is in, 0 is the first after the letter */
+    char bad;       /*!< Offending character, for CMD_ERR_CMD, _LETTER and _NUM */
+    char letter;    /*!< waveType_t, sweepLaw_t, modType_t or seqCtl_t */
+    uint16_t num[CMD_MAX_NUMS]; /*!< Numbers, in the order of the fields */
+} command_t;
+
+/*--------- Prototype dec ---------*/
+
+void cmd_rx(uint8_t c);
+uint8_t cmd_get(command_t * cmd);
+uint8_t cmd_dropped(void);
+uint8_t cmd_wave_valid(uint8_t c);
+uint8_t cmd_letter_valid(cmd_t cmd, uint8_t c);
+const char * cmd_echo(void);
+
+#endif /* __CMD_H__ */
+
+/*--------- EOF ---------*/
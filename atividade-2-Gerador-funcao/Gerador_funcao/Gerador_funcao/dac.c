@@ -0,0 +1,74 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   dac.c
+   @brief  DAC output backends, see dac.h.
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/io.h>
+
+#include <stdint.h>
+
+#include "util.h"
+
+#include "dac.h"
+
+/*--------- Function definition ---------*/
+/**
+   Set up the pins (and the SPI) the DAC is on.
+*/
+void dac_init(void)
+{
+#if DAC_BACKEND == DAC_SPI
+    set_bit(DAC_CS); // Idle high, the sample ISR expects it so
+    DDRC |= 1 << 3;
+    DDRB |= (1 << DDB2) | (1 << DDB3) | (1 << DDB5); // SS, MOSI, SCK
+    SPCR = (1 << SPE) | (1 << MSTR); // Mode 0, MSB first
+    SPSR = 1 << SPI2X; // fosc/2
+#else
+    DDRB = 0xff;
+#endif
+}
+
+/**
+   Set the output to level (0-255, the full scale whatever the DAC width)
+   now. Only while the sample ISR is off, it owns the DAC otherwise.
+*/
+void dac_write(uint8_t level)
+{
+#if DAC_BACKEND == DAC_SPI
+    uint16_t v = (uint16_t)level << (DAC_BITS - 8);
+    set_bit(DAC_CS); // Ends the frame the sample ISR left open, if any
+    rst_bit(DAC_CS);
+    (void)SPSR; // With the SPDR write below, clears a SPIF the sample ISR left
+    SPDR = DAC_SPI_CMD | (v >> 8);
+    while(!(SPSR & (1 << SPIF)));
+    SPDR = v & 0xff;
+    while(!(SPSR & (1 << SPIF)));
+    set_bit(DAC_CS); // Latches it
+#else
+    DAC_PORT = level;
+#endif
+}
+
+/*--------- EOF ---------*/
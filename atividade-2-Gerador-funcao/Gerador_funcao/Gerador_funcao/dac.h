@@ -0,0 +1,93 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   dac.h
+   @brief  DAC output backends, chosen at build time with DAC_BACKEND.
+
+   - DAC_PARALLEL: the R2R ladder / DAC0800 (see hardware/) on all of PORTB,
+     8 bits. The sample ISR writes a sample with a single out, and fast mode
+     (see fast.h) plays on it too. PORTB leaves no pins for a crystal, so
+     the CPU runs on the internal RC oscillator.
+   - DAC_SPI: an MCP4921 (12 bits) on the SPI port, CS on PC3 and LDAC tied
+     low. Only PB2 (SS, kept an output so the SPI stays master, and the
+     pulse output, see pulse.h), PB3 (MOSI) and PB5 (SCK) are used, PB6/PB7
+     are free for an 8 MHz crystal. The wave tables have to be built 12 bits
+     wide for it (make WAVE_BITS=12, see Debug/Makefile).
+
+   The SPI backend keeps the output timing of the parallel one: the sample
+   ISR (dds_isr.s) raises CS first thing, which makes the DAC latch the
+   frame sent in the previous interrupt, at a fixed time after the timer
+   match. It then starts the frame for the next sample, the one computed
+   last time, and the SPI (fosc/2, 16 cycles a byte) shifts it out while the
+   ISR computes the sample after it. The second byte goes in once the phase
+   has been advanced, far enough from the first not to collide.
+
+   Samples played from 8 bit sources (the AWG table, the uart stream, the
+   noise and dac_write()) go to the top 8 of the 12 bits, so 128 is still
+   the middle of the scale.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __DAC_H__
+#define __DAC_H__
+
+/*--- Config ---*/
+
+#define DAC_PARALLEL (0)
+#define DAC_SPI      (1)
+
+#define DAC_BACKEND DAC_PARALLEL
+
+/*--- Constants ---*/
+
+#if DAC_BACKEND == DAC_SPI
+#define DAC_BITS (12)
+#define DAC_SPI_CMD (0x30) /*!< MCP4921 frame MSB: DAC A, unbuffered, 1x gain, on */
+#else
+#define DAC_BITS (8)
+#endif
+
+/*--- Pin definition ---*/
+/*
+  Since we'll be using the whole PORTB, the processor needs to use the internal
+  oscillator so we can free the XTAL pins on PORTB. Not so with the SPI DAC.
+ */
+#if DAC_BACKEND == DAC_SPI
+#define DAC_CS PORTC,3
+#else
+#define DAC_PORT PORTB
+#endif
+
+#ifndef __ASSEMBLER__
+
+/*--- Includes ---*/
+
+#include <stdint.h>
+
+/*--------- Prototype dec ---------*/
+
+void dac_init(void);
+void dac_write(uint8_t level);
+
+#endif /* __ASSEMBLER__ */
+
+#endif /* __DAC_H__ */
+
+/*--------- EOF ---------*/
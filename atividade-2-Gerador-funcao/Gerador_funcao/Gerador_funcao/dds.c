@@ -0,0 +1,727 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   dds.c
+   @brief  Direct digital synthesis engine, see dds.h.
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util.h"
+
+#include "dds.h"
+
+/*--------- Macros ---------*/
+
+#if USE_PROGMEM == 1
+#define TAB_ALLOC PROGMEM
+#else
+#define TAB_ALLOC
+#endif
+
+/*--------- Constants ---------*/
+/**
+   WAVE_LEN point LUT's for all curves, except the sine which is stored as
+   a SINE_LEN/4 point quarter wave. Generated at build time by lut-gen.py
+   (see Debug/Makefile). All of them have guard points for the interpolating
+   render routines, the quarter sine starts with one.
+
+   Triangle, sawtooth and square are band limited, WAVE_MIPS tables each,
+   one per octave of the playback frequency.
+*/
+#include "wavetables.h"
+
+#if DAC_BACKEND == DAC_PARALLEL && WAVE_BITS > 8
+#error "DAC_PORT is 8 bits wide, build the tables with at most 8 bits"
+#elif DAC_BACKEND == DAC_SPI && WAVE_BITS != DAC_BITS
+#error "The sample ISR plays DAC_BITS wide tables to the SPI DAC, build them so (WAVE_BITS)"
+#endif
+
+#if PHASE_BITS != 24
+#error "The tuning conversions below assume a 24 bit phase accumulator"
+#endif
+
+/*
+  mHz <-> tuning word scales for mul_q24(). 2^24 * 2^24 / (SAMPLE_RATE in
+  mHz) is 14073749 for 20 kHz, rounded at compile time.
+*/
+#define MHZ_TO_TUNING (((1ULL << 48) + SAMPLE_RATE*500ULL) / (SAMPLE_RATE*1000ULL))
+#define TUNING_TO_MHZ (SAMPLE_RATE*1000UL)
+
+#define FILL_LEN (256) /* Points dds_fill() writes, one per value of the phase top byte */
+
+#define DDS_PARAMS_TAKEN (0) /* dds_params_new, nothing published */
+
+/* Table read outside the ISR, from flash or RAM as they were allocated */
+#if USE_PROGMEM == 1
+#define TAB_READ(p) pgm_read_byte(p)
+#else
+#define TAB_READ(p) (*(p))
+#endif
+
+/*--------- Types ---------*/
+/**
+   What the main loop hands to the sample ISR at a period boundary, see
+   dds_publish(). Laid out for dds_isr.s, which copies it by offset.
+*/
+typedef struct ddsParams {
+    void (* render)(void);  /*!< Becomes dds_render, unless resting between bursts */
+    const wave_t * table;   /*!< Becomes dds_table */
+    phase_t tuning;         /*!< Becomes dds_tuning, if DDS_PARAM_TUNING */
+    uint8_t what;           /*!< DDS_PARAM_* */
+} ddsParams_t;
+
+_Static_assert(sizeof(ddsParams_t) == DDS_PARAMS_SIZE, "dds_isr.s copies ddsParams_t by offset");
+
+/*--------- Function dec ---------*/
+/*
+  Render routines, entry points inside the sample ISR (dds_isr.s). They
+  are only jumped to from there, never call them.
+*/
+extern void dds_render_table(void);
+extern void dds_render_qsine(void);
+extern void dds_render_table_interp(void);
+extern void dds_render_qsine_interp(void);
+extern void dds_render_ram(void);
+extern void dds_render_ram_interp(void);
+extern void dds_render_stream(void);
+extern void dds_render_rest(void);
+extern void dds_render_white(void);
+extern void dds_render_pink(void);
+
+/*--------- Globals ---------*/
+/*
+  Read by the sample ISR in dds_isr.s, hence not static. The phase
+  accumulator itself is kept in GPIOR0..2.
+*/
+const wave_t * volatile dds_table = sqre_lut[0]; // Table played by the ISR
+void (* volatile dds_render)(void) = dds_render_table; // How to play it
+volatile phase_t dds_tuning = 0; // Added to the phase every sample
+volatile uint8_t dds_tuning_frac = 0; // 8 bits below dds_tuning, for sweeps
+volatile int32_t dds_slope = 0; // Added to dds_tuning:dds_tuning_frac every sample
+volatile uint8_t dds_sweeping = 0; // dds_slope is not 0
+volatile uint8_t dds_amplitude = DDS_FULL_SCALE; // Samples scaled by amplitude/256...
+#if DAC_BITS > 8
+volatile int16_t dds_offset = 0; // ...around 2048 + dds_offset (12 bits)
+#else
+volatile int8_t dds_offset = 0; // ...around 128 + dds_offset
+#endif
+volatile uint8_t dds_scaling = 0; // DDS_SCALE_*, not full scale around 128 or AM
+volatile uint8_t dds_am_env[DDS_AM_LEN]; // AM, the amplitude over a modulation period...
+volatile phase_t dds_am_phase = 0; // ...indexed by the top bits of this
+volatile phase_t dds_am_step = 0; // Added to dds_am_phase every sample, 0 with AM off
+#if DAC_BACKEND == DAC_SPI
+volatile uint16_t dds_next = (DAC_SPI_CMD << 8) | 0x800; // Frame sent at the next sample tick, MSB first
+#else
+volatile uint8_t dds_next = 127; // Sample written at the next sample tick
+#endif
+volatile ddsParams_t dds_params[2]; // Filled in turns by dds_publish()
+volatile uint8_t dds_params_new = DDS_PARAMS_TAKEN; // 1 + index of the block to take at the next period
+volatile uint16_t dds_burst = 0; // Periods left in the burst, 0 for none
+volatile uint8_t dds_step_ready = 0; // The step below replaces the burst at its end
+void (* volatile dds_step_render)(void);
+const wave_t * volatile dds_step_table;
+volatile phase_t dds_step_tuning;
+volatile uint16_t dds_step_periods;
+volatile phase_t dds_lfsr = 0xace1; // Noise generator state, never 0
+uint8_t dds_pink_rows[8] __attribute__((aligned(8))); // Pink noise octaves, 0-15 each
+uint8_t dds_pink_count = 0; // Picks the row updated, by its trailing zeros
+uint8_t dds_pink_sum = 0; // Sum of dds_pink_rows
+
+static waveType_t dds_wave = WAVE_SQRE;
+static uint8_t dds_interp = USE_INTERP;
+static const wave_t (* dds_mips)[WAVE_LEN + 1] = sqre_lut; // Band limited set played, NULL for the sine
+static uint8_t dds_mip = 0; // Level of dds_mips for the current frequency
+static const wave_t * dds_awg = NULL; // RAM table played as WAVE_AWG
+static void (* dds_wave_render)(void) = dds_render_table; // dds_render, but for the bursts
+static const wave_t * dds_wave_table = NULL; // Table of dds_wave, if not band limited
+static phase_t dds_freq_tuning = 0; // Last tuning word set by dds_set_freq()
+static uint8_t dds_params_last = 1; // Block published last, the other one is free
+static uint8_t dds_burst_mode = 0; // Only play on dds_trigger()
+
+/*--------- Function definition ---------*/
+/**
+   Band limited level for a tuning word: level k is alias free while the
+   phase steps less than 2^k table points per sample (see lut-gen.py), so
+   it is the bit length of the step, no division needed.
+*/
+static uint8_t dds_mip_level(phase_t tuning)
+{
+    uint8_t level = 0;
+    tuning >>= PHASE_BITS - WAVE_LEN_LOG2 + WAVE_MIP_FIRST;
+    while(tuning && level < WAVE_MIPS - 1) {
+        tuning >>= 1;
+        ++level;
+    }
+    return level;
+}
+
+/**
+   Play level mip of the band limited waves, with interrupts off.
+*/
+static void dds_use_mip(uint8_t mip)
+{
+    dds_mip = mip;
+    if(dds_mips) {
+        dds_table = dds_mips[mip];
+    }
+}
+
+/**
+   Take the block published last now, as the sample ISR would at the next
+   period, with interrupts off. Anything that changes the live state
+   directly calls this first, so a block still pending can not undo it
+   later.
+*/
+static void dds_params_take(void)
+{
+    if(dds_params_new == DDS_PARAMS_TAKEN) {
+        return;
+    }
+    volatile ddsParams_t * p = &dds_params[dds_params_new - 1];
+    if(dds_render != dds_render_rest) {
+        dds_render = p->render; // Between bursts dds_trigger() picks it up
+    }
+    dds_table = p->table;
+    if(p->what & DDS_PARAM_TUNING) {
+        dds_tuning = p->tuning;
+        dds_tuning_frac = 0;
+    }
+    dds_params_new = DDS_PARAMS_TAKEN;
+}
+
+/**
+   Hand the wave and, with DDS_PARAM_TUNING in what, the frequency last set
+   to the sample ISR, which takes them together at the start of the next
+   period. The main loop never blocks the ISR for it: the block the ISR may
+   be reading is left alone, the other one is filled and only then made the
+   one to take, with a single byte store. A block still pending is replaced,
+   whatever it carried is carried on.
+
+   Only called from the main loop, never from an ISR (it would fill the
+   same block).
+*/
+static void dds_publish(uint8_t what)
+{
+    uint8_t i = dds_params_last ^ 1;
+    volatile ddsParams_t * p = &dds_params[i];
+    uint8_t pending = dds_params_new; // Read once, the ISR may take it meanwhile
+
+    if(pending != DDS_PARAMS_TAKEN) {
+        what |= dds_params[pending - 1].what;
+    }
+    p->render = dds_wave_render;
+    p->table = dds_mips ? dds_mips[dds_mip] : dds_wave_table;
+    p->tuning = dds_freq_tuning;
+    p->what = what;
+    dds_params_last = i;
+    dds_params_new = i + 1; // The ISR sees all of it from here on
+
+    if(!(TIMSK1 & (1 << OCIE1A))) {
+        // Sample clock stopped, no period to wait for
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            dds_params_take();
+        }
+    }
+}
+
+/**
+   Table (or band limited set, mips) and render routine that play w.
+   Returns 0 if w can not be played.
+*/
+static uint8_t dds_lookup(waveType_t w, const wave_t (** mips)[WAVE_LEN + 1],
+                          const wave_t ** table, void (** render)(void))
+{
+    *mips = NULL;
+    *table = NULL;
+    *render = dds_interp ? dds_render_table_interp : dds_render_table;
+
+    switch(w) {
+    case WAVE_SINE:
+        *table = sine_qlut + 1; // Skip the leading guard point
+        *render = dds_interp ? dds_render_qsine_interp : dds_render_qsine;
+        break;
+    case WAVE_AWG:
+        if(!dds_awg) {
+            return 0; // Nothing uploaded
+        }
+        *table = dds_awg;
+        *render = dds_interp ? dds_render_ram_interp : dds_render_ram;
+        break;
+    case WAVE_STREAM:
+        *render = dds_render_stream; // Does not use a table
+        break;
+    case WAVE_WHITE:
+        *render = dds_render_white; // Neither do the noises
+        break;
+    case WAVE_PINK:
+        *render = dds_render_pink;
+        break;
+    case WAVE_TRGL:
+        *mips = trgl_lut;
+        break;
+    case WAVE_SWTT:
+        *mips = swtt_lut;
+        break;
+    case WAVE_SQRE:
+        *mips = sqre_lut;
+        break;
+    default:
+        return 0;
+    }
+    return 1;
+}
+
+/**
+   Look w up for dds_publish(), returns 0 if it can not be played.
+*/
+static uint8_t dds_wave_select(waveType_t w)
+{
+    const wave_t (* mips)[WAVE_LEN + 1];
+    const wave_t * table;
+    void (* render)(void);
+
+    if(!dds_lookup(w, &mips, &table, &render)) {
+        return 0;
+    }
+    dds_wave = w;
+    dds_mips = mips;
+    dds_wave_table = table;
+    dds_wave_render = render;
+    return 1;
+}
+
+/**
+   Select the wave played by the sample ISR, from the start of the next
+   period. The table and render routine are looked up once here, so the ISR
+   does not have to branch on the wave type.
+*/
+void dds_set_wave(waveType_t w)
+{
+    if(dds_wave_select(w)) {
+        dds_publish(0);
+    } // Else keep playing the current wave
+}
+
+/**
+   Turn interpolation between table points on or off. The phase bits below
+   the table index blend each point with the next one, which takes away
+   the staircase at low frequencies at the cost of a longer sample ISR (see
+   dds_isr.s).
+*/
+void dds_set_interp(uint8_t on)
+{
+    dds_interp = on;
+    dds_set_wave(dds_wave); // Pick the render routine again
+}
+
+/**
+   Set the RAM table (WAVE_LEN + 1 samples, the last one a copy of the
+   first) played as WAVE_AWG. If it is being played, the sample ISR swaps
+   the new table in at the start of the next period, until then the old one
+   must be left alone (see dds_awg_pending()). From the main loop, as
+   dds_set_wave().
+*/
+void dds_set_awg(const uint8_t * table)
+{
+    dds_awg = (const wave_t *)table; // Read a byte a point all the same, see dds_isr.s
+    if(dds_wave == WAVE_AWG) {
+        dds_wave_select(WAVE_AWG);
+        dds_publish(0);
+    } // Else picked up by dds_set_wave()
+}
+
+/**
+   Whether what was last set (a table given to dds_set_awg() among it) is
+   still waiting for the next period to start.
+*/
+uint8_t dds_awg_pending(void)
+{
+    return dds_params_new != DDS_PARAMS_TAKEN;
+}
+
+/**
+   Whether the sample ISR plays the RAM table t, or has it queued as the
+   next step (see dds_step()), which keeps the table of a list step after
+   dds_set_awg() moved on to another one. t must be left alone until not.
+*/
+uint8_t dds_awg_in_use(const uint8_t * t)
+{
+    const wave_t * w = (const wave_t *)t;
+    uint8_t r;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        r = dds_table == w || (dds_step_ready && dds_step_table == w);
+    }
+    return r;
+}
+
+/**
+   (a * b) / 2^24, rounded, for a < 2^24 and b < 2^26.
+
+   From four 16 x 16 bit products, which avr-gcc does with the MUL
+   instruction: about 150 cycles whatever the operands, where the 64 bit
+   division it replaces took several thousand.
+*/
+static uint32_t mul_q24(uint32_t a, uint32_t b)
+{
+    uint16_t al = a, ah = a >> 16;
+    uint16_t bl = b, bh = b >> 16;
+    uint32_t hi = (uint32_t)ah*bh;
+    uint32_t mid = (uint32_t)ah*bl + (uint32_t)al*bh;
+    uint32_t lo = (uint32_t)al*bl;
+    // The bits under 2^16 of lo can not carry into the result
+    return (hi << 8) + ((mid + (lo >> 16) + 0x80) >> 8);
+}
+
+/**
+   Tuning word and band limited level for a frequency in mHz, for
+   dds_publish(). Returns the frequency they play.
+*/
+static uint32_t dds_freq_select(uint32_t f_mhz)
+{
+    if(f_mhz > DDS_MAX_MHZ) {
+        f_mhz = DDS_MAX_MHZ;
+    }
+    dds_freq_tuning = mul_q24(f_mhz, MHZ_TO_TUNING);
+    dds_mip = dds_mip_level(dds_freq_tuning);
+    return mul_q24(dds_freq_tuning, TUNING_TO_MHZ);
+}
+
+/**
+   Set the output frequency, returns the one actually set.
+
+   tuning = f * 2^PHASE_BITS / SAMPLE_RATE, with f in mHz, within 0.6 of
+   the exact word, so the frequency is off by 0.7 mHz at most. Anything over
+   DDS_MAX_MHZ is clamped.
+
+   Also moves the band limited waves to the level for the new frequency,
+   which is only a table pointer switch. Both are played from the start of
+   the next period, nothing is published if the tuning word did not change.
+*/
+uint32_t dds_set_freq(uint32_t f_mhz /*!< frequency in mHz */)
+{
+    uint32_t actual = dds_freq_select(f_mhz);
+    if((uint32_t)dds_freq_tuning << 8 != dds_get_tuning()) {
+        dds_publish(DDS_PARAM_TUNING); // Not sweeping (sweep_stop() first), so only written here
+    }
+    return actual;
+}
+
+/**
+   dds_set_wave() and dds_set_freq() at once, the ISR never plays the new
+   wave at the old frequency or the other way around. Returns the frequency
+   actually set, the wave is kept if w can not be played.
+*/
+uint32_t dds_set_wave_freq(waveType_t w, uint32_t f_mhz)
+{
+    dds_wave_select(w);
+    uint32_t actual = dds_freq_select(f_mhz);
+    dds_publish(DDS_PARAM_TUNING);
+    return actual;
+}
+
+/**
+   Tuning word for a frequency in mHz, 24.8 fixed point, clamped to
+   DDS_MAX_MHZ. For sweeps.
+*/
+uint32_t dds_freq_to_tuning(uint32_t f_mhz)
+{
+    if(f_mhz > DDS_MAX_MHZ) {
+        f_mhz = DDS_MAX_MHZ;
+    }
+    return mul_q24(f_mhz, MHZ_TO_TUNING) << 8;
+}
+
+/**
+   Current tuning word, 24.8 fixed point, as a sweep left it. One set but
+   waiting for the next period counts as current.
+*/
+uint32_t dds_get_tuning(void)
+{
+    uint32_t t;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t n = dds_params_new;
+        if(n != DDS_PARAMS_TAKEN && (dds_params[n - 1].what & DDS_PARAM_TUNING)) {
+            t = (uint32_t)dds_params[n - 1].tuning << 8;
+        } else {
+            t = (uint32_t)dds_tuning << 8 | dds_tuning_frac;
+        }
+    }
+    return t;
+}
+
+/**
+   Current frequency in mHz, also while sweeping.
+*/
+uint32_t dds_get_freq(void)
+{
+    return mul_q24(dds_get_tuning() >> 8, TUNING_TO_MHZ);
+}
+
+/**
+   Jump to a tuning word, 24.8 fixed point, keeping the slope. The phase
+   goes on from where it is.
+*/
+void dds_set_tuning(uint32_t tuning)
+{
+    uint8_t mip = dds_mip_level(tuning >> 8);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        dds_params_take();
+        dds_tuning = tuning >> 8;
+        dds_tuning_frac = tuning;
+        dds_use_mip(mip);
+    }
+}
+
+/**
+   Have the sample ISR add slope (24.8 fixed point, signed) to the tuning
+   word every sample, 0 turns it off. top is the highest tuning word the
+   slope reaches before the next call, the band limited waves are switched
+   to its level so they do not alias on the way up.
+*/
+void dds_set_slope(int32_t slope, uint32_t top)
+{
+    uint8_t mip = dds_mip_level(top >> 8);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        dds_params_take();
+        dds_slope = slope;
+        dds_sweeping = slope != 0;
+        dds_use_mip(mip);
+    }
+}
+
+/**
+   Output level: the samples are scaled by amplitude/256 and centered on
+   offset (both 0-255), clipping at the DAC limits. DDS_FULL_SCALE around
+   128 is the wave as stored, which skips the scaling in the sample ISR.
+*/
+void dds_set_level(uint8_t amplitude, uint8_t offset)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        dds_amplitude = amplitude;
+#if DAC_BITS > 8
+        dds_offset = ((int16_t)offset - 128) << (DAC_BITS - 8);
+#else
+        dds_offset = offset - 128;
+#endif
+        dds_scaling = (dds_scaling & (1 << DDS_SCALE_AM_BIT)) |
+            (amplitude != DDS_FULL_SCALE || offset != 128 ? DDS_SCALE_LEVEL : 0);
+    }
+}
+
+/**
+   Point i (0 to DDS_AM_LEN - 1) of the AM envelope, the amplitude (as in
+   dds_set_level()) at i/DDS_AM_LEN of the modulation period. Played from
+   the next sample, if AM is on.
+*/
+void dds_set_am_point(uint8_t i, uint8_t amplitude)
+{
+    if(i < DDS_AM_LEN) {
+        dds_am_env[i] = amplitude;
+    }
+}
+
+/**
+   AM: the samples are scaled by the envelope (dds_set_am_point()) instead
+   of the amplitude set with dds_set_level(), which still sets the offset.
+   The sample ISR plays it through once per modulation period, indexed by
+   the top bits of a phase advanced by step every sample (2^24 a turn).
+   Starts from the first point, a step of 0 stops it.
+*/
+void dds_set_am(phase_t step)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if(!dds_am_step) {
+            dds_am_phase = 0;
+        }
+        dds_am_step = step;
+        if(step) {
+            dds_scaling |= 1 << DDS_SCALE_AM_BIT;
+        } else {
+            dds_scaling &= ~(1 << DDS_SCALE_AM_BIT);
+        }
+    }
+}
+
+/**
+   Burst mode: the output rests at the offset (see dds_set_level()) and
+   dds_trigger() plays a number of periods. Off, the wave plays on.
+*/
+void dds_set_burst(uint8_t on)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        dds_params_take();
+        dds_burst_mode = on;
+        dds_burst = 0;
+        dds_step_ready = 0;
+        dds_render = on ? dds_render_rest : dds_wave_render;
+    }
+}
+
+/**
+   Play periods whole periods of the wave from its start, in burst mode. A
+   trigger during a burst starts it over.
+*/
+void dds_trigger(uint16_t periods)
+{
+    if(!dds_burst_mode || !periods) {
+        return;
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        dds_params_take();
+        GPIOR0 = 0;
+        GPIOR1 = 0;
+        GPIOR2 = 0;
+        dds_burst = periods; // Counted down at each period start
+        dds_render = dds_wave_render;
+    }
+}
+
+/**
+   Queue the next step of a sequence (see seq.h), in burst mode: wave w at
+   tuning for periods whole periods. The sample ISR starts it when the
+   periods of the one playing run out, at the period boundary. If nothing
+   is playing it starts now, from the start of its period. A wave that can
+   not be played rests.
+
+   Returns DDS_STEP_BUSY if the last step queued has not started yet,
+   DDS_STEP_QUEUED, or DDS_STEP_NOW if it started right away.
+*/
+uint8_t dds_step(waveType_t w, phase_t tuning, uint16_t periods)
+{
+    const wave_t (* mips)[WAVE_LEN + 1];
+    const wave_t * table;
+    void (* render)(void);
+    uint8_t r = DDS_STEP_QUEUED;
+
+    if(!dds_lookup(w, &mips, &table, &render) || w == WAVE_STREAM) {
+        render = dds_render_rest;
+    } else if(mips) {
+        table = mips[dds_mip_level(tuning)];
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        dds_params_take();
+        if(dds_step_ready) {
+            r = DDS_STEP_BUSY;
+        } else if(!dds_burst) {
+            GPIOR0 = 0;
+            GPIOR1 = 0;
+            GPIOR2 = 0;
+            dds_render = render;
+            dds_table = table;
+            dds_tuning = tuning;
+            dds_tuning_frac = 0;
+            dds_burst = periods;
+            r = DDS_STEP_NOW;
+        } else {
+            dds_step_render = render;
+            dds_step_table = table;
+            dds_step_tuning = tuning;
+            dds_step_periods = periods;
+            dds_step_ready = 1;
+        }
+    }
+    return r;
+}
+
+/**
+   Whether the step queued by dds_step() has not started yet.
+*/
+uint8_t dds_step_pending(void)
+{
+    return dds_step_ready;
+}
+
+/**
+   Whether a burst or step is playing, not resting.
+*/
+uint8_t dds_burst_playing(void)
+{
+    uint8_t r;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        r = dds_burst != 0;
+    }
+    return r;
+}
+
+#if DAC_BACKEND == DAC_PARALLEL
+/**
+   One period of w in FILL_LEN points, into buf: the table played by the
+   fast mode loop (see fast.h). tuning is the tuning word at its sample
+   rate, for the band limited level. The points are scaled as
+   dds_set_level() does, the sine unfolded from its quarter. Returns 0 if w
+   is not played from a table.
+*/
+uint8_t dds_fill(waveType_t w, phase_t tuning, uint8_t amplitude, uint8_t offset,
+                 uint8_t * buf)
+{
+    const wave_t (* mips)[WAVE_LEN + 1];
+    const wave_t * table;
+    void (* render)(void);
+
+    if(!dds_lookup(w, &mips, &table, &render) || (!mips && !table)) {
+        return 0; // Noise and the stream have no table
+    }
+    if(mips) {
+        table = mips[dds_mip_level(tuning)];
+    }
+    uint8_t scale = amplitude != DDS_FULL_SCALE || offset != 128;
+
+    for(uint16_t i = 0; i < FILL_LEN; ++i) {
+        uint8_t v;
+        if(w == WAVE_SINE) {
+            // As dds_render_qsine: quadrant in the top 2 bits, the index
+            // mirrored in the 2nd and 4th, the value in the 3rd and 4th
+            uint16_t j = (i & 0x3f) << (SINE_LEN_LOG2 - 8);
+            if(i & 0x40) {
+                j = SINE_LEN/4 - 1 - j;
+            }
+            v = TAB_READ(table + j);
+            if(i & 0x80) {
+                v = 255 - v;
+            }
+        } else {
+#if WAVE_LEN_LOG2 >= 8
+            uint16_t j = i << (WAVE_LEN_LOG2 - 8);
+#else
+            uint16_t j = i >> (8 - WAVE_LEN_LOG2);
+#endif
+            v = w == WAVE_AWG ? table[j] : TAB_READ(table + j);
+        }
+        if(scale) {
+            // As dds_scale in dds_isr.s, clipped at the DAC limits
+            int16_t s = offset + (((int16_t)v - 128)*amplitude >> 8);
+            v = s < 0 ? 0 : s > 255 ? 255 : s;
+        }
+        buf[i] = v;
+    }
+    return 1;
+}
+#endif /* DAC_PARALLEL, fast mode only plays there */
+
+/*--------- EOF ---------*/
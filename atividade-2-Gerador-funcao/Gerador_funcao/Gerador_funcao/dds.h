@@ -0,0 +1,126 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   dds.h
+   @brief  Direct digital synthesis (DDS) engine.
+
+   The sample clock (Timer1) runs at a fixed SAMPLE_RATE and every sample
+   adds a tuning word to a PHASE_BITS wide phase accumulator. The upper bits
+   of the accumulator index the wave tables, so the output frequency is
+
+       f = tuning * SAMPLE_RATE / 2^PHASE_BITS
+
+   and the frequency resolution is SAMPLE_RATE / 2^PHASE_BITS (~1.2 mHz).
+
+   The sample ISR is hand written in dds_isr.s. The phase accumulator lives
+   in GPIOR1 (LSB), GPIOR2 and GPIOR0 (MSB), which are reserved for it: no
+   other code may use the general purpose I/O registers.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __DDS_H__
+#define __DDS_H__
+
+/*--- Includes ---*/
+
+#include "dac.h" /* Also for dds_isr.s */
+
+/*--- Config ---*/
+
+#define DEBUG_PULSE_PIN_ISR 0
+#define USE_PROGMEM 1
+#define USE_INTERP 1 /*!< Interpolate between table points at startup */
+
+/*--- Constants ---*/
+
+#define SAMPLE_RATE (20000UL) /*!< Fixed sample clock, Hz */
+#define PHASE_BITS  (24)      /*!< Phase accumulator width, bits */
+#define DDS_MAX_MHZ (SAMPLE_RATE*500UL) /*!< Nyquist, the highest frequency, mHz */
+#define DDS_FULL_SCALE (255) /*!< Amplitude of the waves as stored, see dds_set_level() */
+
+/* dds_step() results */
+#define DDS_STEP_BUSY   (0)
+#define DDS_STEP_QUEUED (1)
+#define DDS_STEP_NOW    (2)
+
+/* dds_scaling, what the sample ISR scales the samples by (dds.c) */
+#define DDS_SCALE_LEVEL  (1 << 0) /*!< Amplitude or offset set, see dds_set_level() */
+#define DDS_SCALE_AM_BIT (1)      /*!< The amplitude follows the AM envelope, see dds_set_am() */
+#define DDS_AM_LEN       (64)     /*!< Points of the AM envelope, one modulation period */
+
+/* Parameter block taken by the sample ISR at a period boundary (dds.c) */
+#define DDS_PARAMS_SIZE  (8)      /*!< render (2), table (2), tuning (3), what */
+#define DDS_PARAM_TUNING (1 << 0) /*!< what: the tuning word changes too */
+
+/*--- Pin definition ---*/
+
+#define DEBG_PIN PORTC,2 /*!< The DAC pins are in dac.h */
+
+#ifndef __ASSEMBLER__
+
+/*--- Includes ---*/
+
+#include <stdint.h>
+
+/*--------- Types ---------*/
+
+typedef __uint24 phase_t; /*!< Phase accumulator and tuning word type */
+
+typedef enum waveType {
+    WAVE_SINE = 's', /*!< Sine wave */
+    WAVE_SQRE = 'q', /*!< Square wave */
+    WAVE_SWTT = 'w', /*!< Sawtooth */
+    WAVE_TRGL = 't', /*!< Triangle */
+    WAVE_AWG  = 'a', /*!< Arbitrary, uploaded to RAM (see awg.h) */
+    WAVE_STREAM = 'x', /*!< Uart sample stream, one per period (see stream.h) */
+    WAVE_WHITE = 'n', /*!< White noise, frequency only paces bursts */
+    WAVE_PINK = 'p', /*!< Pink (1/f) noise, likewise */
+    WAVE_PULSE = 'u' /*!< Timer1 hardware pulse, not the DDS (see pulse.h) */
+} waveType_t;
+
+/*--------- Prototype dec ---------*/
+
+void dds_set_wave(waveType_t w);
+void dds_set_interp(uint8_t on);
+void dds_set_awg(const uint8_t * table);
+uint8_t dds_awg_pending(void);
+uint8_t dds_awg_in_use(const uint8_t * t);
+uint32_t dds_set_freq(uint32_t f_mhz);
+uint32_t dds_set_wave_freq(waveType_t w, uint32_t f_mhz);
+uint32_t dds_freq_to_tuning(uint32_t f_mhz);
+uint32_t dds_get_tuning(void);
+uint32_t dds_get_freq(void);
+void dds_set_tuning(uint32_t tuning);
+void dds_set_slope(int32_t slope, uint32_t top);
+void dds_set_level(uint8_t amplitude, uint8_t offset);
+void dds_set_am_point(uint8_t i, uint8_t amplitude);
+void dds_set_am(phase_t step);
+void dds_set_burst(uint8_t on);
+void dds_trigger(uint16_t periods);
+uint8_t dds_step(waveType_t w, phase_t tuning, uint16_t periods);
+uint8_t dds_step_pending(void);
+uint8_t dds_burst_playing(void);
+uint8_t dds_fill(waveType_t w, phase_t tuning, uint8_t amplitude, uint8_t offset, uint8_t * buf);
+
+#endif /* __ASSEMBLER__ */
+
+#endif /* __DDS_H__ */
+
+/*--------- EOF ---------*/
@@ -0,0 +1,1047 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   dds_isr.s
+   @brief  DDS sample ISR, hand written for a fixed cycle count.
+
+   The sample computed in the previous interrupt is written to the DAC before
+   anything else, so the output changes a constant 12 cycles after the timer
+   match (9 with the SPI DAC, see below), no matter how long the rest of
+   the ISR takes. Only then the phase
+   is advanced and the next sample is computed and kept in dds_next.
+
+   Only the registers actually touched are saved and the phase accumulator is
+   kept in GPIOR0..2 (single cycle in/out, GPIOR0 also works with sbic/sbis).
+   What to play is chosen once by dds_set_wave(): a table pointer and the
+   render routine the ISR jumps to (ijmp), so there is no branching on the
+   wave type per sample.
+
+   - dds_render_table plays a full period table. The table length is a power
+     of two (WAVE_LEN, see lut-gen.py), so the index is just the top
+     WAVE_LEN_LOG2 bits of the phase.
+   - dds_render_qsine plays the sine from its first quarter: the two top
+     phase bits are the quadrant, the index is mirrored (bitwise not) in the
+     2nd and 4th quadrants and the value inverted in the 3rd and 4th.
+   - dds_render_table_interp and dds_render_qsine_interp do the same, but
+     blend the point under the phase with the next one, weighted by the 8
+     phase bits below the index (linear interpolation, 2 MULs). The tables
+     have guard points so the next point never needs a wrap around.
+   - dds_render_ram and dds_render_ram_interp play a full period table kept
+     in RAM, the uploaded AWG waveform (see awg.h).
+   - dds_render_stream plays the uart sample stream (see stream.h), taking
+     a new sample off the ring at the start of every period.
+   - dds_render_rest holds the output at the offset, between bursts.
+   - dds_render_white and dds_render_pink play noise from an LFSR, the
+     phase only counts periods for the bursts there.
+
+   When the phase add carries out a new period starts, and the parameter
+   block last published by the main loop (dds_set_wave(), dds_set_freq(),
+   dds_set_awg(), see dds_publish() in dds.c) replaces the render routine,
+   table and tuning word all at once, so a new wave or frequency always
+   starts at the beginning of its period and never plays half set. A burst
+   (dds_trigger()) counts its periods there too, and after the last one the
+   next step of a sequence (dds_step(), seq.h) takes over if there is one,
+   or the output rests in dds_render_rest.
+
+   Cycle budget (ATmega328P @ 8 MHz, counted from the datasheet):
+
+     interrupt response + jmp from the vector table     7
+     push r24, DAC write from dds_next                  5
+     prologue (SREG, r25, r30, r31)                     9
+     sweep check                                        4
+     phase += tuning (24 bits)                         15
+     period boundary check                              1
+     jump to the render routine                         6
+     render                                             see below
+     amplitude/offset check                             4
+     store to dds_next                                  2
+     epilogue + reti                                   15
+                                                      ---
+                                                       68 + render
+
+   Once per period the boundary check takes 15 more cycles, 50 when it
+   takes a parameter block (35 without a tuning word), and 5 more during a
+   burst, 14 at its end, 50 if it starts the next step of a sequence. While
+   a sweep runs (see sweep.h) every sample takes 31 more, for the tuning +=
+   slope, and with an amplitude or offset set (see dds_set_level()) 26
+   more, 28 if the sample clips. With AM on (see dds_set_am()) the scaling
+   also steps the envelope, 55 more, 57 clipping.
+
+   Render cost, by table length:
+
+     WAVE_LEN                    64   128   256   512  1024
+     dds_render_table            12    11    10    15    18
+     dds_render_table_interp     44    42    40    46    50
+     dds_render_ram              13    12    11    16    19
+     dds_render_ram_interp       44    42    40    46    50
+
+     SINE_LEN                   256   512  1024  2048
+     dds_render_qsine            25    24    22    29
+     dds_render_qsine_interp     49    53    55    63
+
+   dds_render_stream takes 0 cycles within a period and 11 at its start, 22
+   if the ring is empty (25 the first time, counting the underrun).
+   dds_render_rest takes 3, dds_render_white 35 and dds_render_pink 81.
+
+   So a sample costs 78 cycles with the default 256 point tables and 90 with
+   the default 1024 point sine, 108 and 123 interpolated. The worst case is
+   149 cycles, pink noise (131 for a table, an interpolated 2048 point sine),
+   206 with AM, and once per period up to 292 (214 at a sequence step, plus
+   scaling and a parameter block).
+
+   With the SPI DAC (DAC_BACKEND, see dac.h) raising CS latches the sample
+   instead, and the frame of the next one starts right after: the second
+   byte goes in after the phase add and the SPI shifts both out while the
+   ISR goes on. The flash tables are 12 bits wide, their renders read 2
+   bytes a point and interpolate 16 bit differences (dds_lerp_w), and the
+   8 bit samples (RAM table, stream, noise, rest) are moved to the top 8
+   bits by dds_render_done8. A sample costs 78 cycles + render, 7 more for
+   an 8 bit one, and scaling 36 more (40 clipping), 65 with AM (69):
+
+     WAVE_LEN                    64   128   256   512  1024
+     dds_render_table            18    17    16    20    23
+     dds_render_table_interp     64    62    60    65    69
+
+     SINE_LEN                   256   512  1024  2048
+     dds_render_qsine            31    30    28    32
+     dds_render_qsine_interp     68    72    74    79
+
+   So 94 cycles with the default tables and 106 with the default sine, 138
+   and 152 interpolated. The worst case is 166 cycles, pink noise, 235 with
+   AM, and up to 321 once per period.
+
+   Timer1 reloads itself (see main.c), so the only sample jitter left is
+   the 0-3 cycles the CPU may take to finish the current instruction (4 to
+   wake up, when the main loop sleeps, see event.h), plus the few cycles
+   another ISR needs to reach its sei (all of them re-enable interrupts
+   first thing, the Timer2 clock one 6 cycles in and again for its last 9,
+   see event.c, except the uart UDRE one which is short, about 50 cycles,
+   see uart.c). 149 cycles is 18.6 us, so the sample clock can not go above
+   ~53 kHz even with the CPU doing nothing else; at the default SAMPLE_RATE
+   of 20 kHz the ISR takes at most 37% of the CPU (42% with the SPI DAC),
+   52% with AM (59%). The R2R ladder and the DAC0800 (100 ns settling) are
+   far from being the limit, and so is the MCP4921 (4.5 us).
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/io.h>
+
+#include "dds.h"
+#include "wavetables.h"
+
+/*--------- Macros ---------*/
+
+#define _io_bit(port, bit) _SFR_IO_ADDR(port), bit
+#define io_bit(P) _io_bit(P)
+
+#define PHASE0 _SFR_IO_ADDR(GPIOR1) /* LSB */
+#define PHASE1 _SFR_IO_ADDR(GPIOR2)
+#define PHASE2 _SFR_IO_ADDR(GPIOR0) /* MSB, bit addressable */
+
+/* Table read, from flash or RAM as the tables were allocated (dds.c) */
+#if USE_PROGMEM == 1
+#define LD_TAB lpm
+#else
+#define LD_TAB ld
+#endif
+
+/*
+  Bytes per point of the flash tables: 16 bits for the SPI DAC (see dac.h),
+  the samples in r25:r24 from there on. The RAM tables always take one.
+*/
+#if WAVE_BITS > 8
+#define TAB_SIZE 2
+#define WAVE_MSB_MASK ((1 << (WAVE_BITS - 8)) - 1)
+#else
+#define TAB_SIZE 1
+#endif
+
+/*
+  Z = dds_table + size*phase[23:24-WAVE_LEN_LOG2], for the phase MSB in r24
+  and size byte points
+*/
+.macro table_index size=1
+#if WAVE_LEN_LOG2 <= 8
+    lds  r30, dds_table
+    lds  r31, dds_table+1
+    .rept 8 - WAVE_LEN_LOG2
+    lsr  r24
+    .endr
+    add  r30, r24
+    brcc 1f                     ; 2 cycles taken or not, no zero reg needed
+    inc  r31
+1:
+    .if \size == 2
+    add  r30, r24               ; Twice
+    brcc 1f
+    inc  r31
+1:
+    .endif
+#else
+    /* Shifting the index left is shorter */
+    in   r25, PHASE1
+    clr  r31
+    .rept WAVE_LEN_LOG2 - 8
+    lsl  r25
+    rol  r24
+    rol  r31
+    .endr
+    .if \size == 2
+    lsl  r24
+    rol  r31
+    .endif
+    mov  r30, r24
+    lds  r24, dds_table
+    lds  r25, dds_table+1
+    add  r30, r24
+    adc  r31, r25
+#endif
+.endm
+
+/* As table_index, plus the 8 phase bits below the index in r25 (uses r26) */
+.macro table_index_frac size=1
+    in   r25, PHASE1
+#if WAVE_LEN_LOG2 <= 8
+    .rept 8 - WAVE_LEN_LOG2
+    lsr  r24
+    ror  r25
+    .endr
+    lds  r30, dds_table
+    lds  r31, dds_table+1
+    add  r30, r24
+    brcc 1f
+    inc  r31
+1:
+    .if \size == 2
+    add  r30, r24
+    brcc 1f
+    inc  r31
+1:
+    .endif
+#else
+    in   r26, PHASE0
+    clr  r31
+    .rept WAVE_LEN_LOG2 - 8
+    lsl  r26
+    rol  r25
+    rol  r24
+    rol  r31
+    .endr
+    .if \size == 2
+    lsl  r24
+    rol  r31
+    .endif
+    mov  r30, r24
+    lds  r24, dds_table
+    lds  r26, dds_table+1
+    add  r30, r24
+    adc  r31, r26
+#endif
+.endm
+
+/*
+  Advance the noise LFSR 8 steps, r24 = 8 new bits (uses r25, r30, r31).
+
+  A 24 bit Galois LFSR, x^24 + x^23 + x^22 + x^17 + 1 (taps 0xe10000),
+  shifting right: maximal length, it repeats after 2^24 - 1 bits, 105 s of
+  noise at 20 kHz. All taps are in the top byte, so 8 steps at once are
+  just L' = M, M' = H ^ L<<1 ^ L<<6 ^ L<<7 and H' = L ^ L>>1 ^ L>>2 ^ L>>7,
+  for the state bytes H:M:L, and L' are the 8 bits shifted out. 33 cycles.
+*/
+#define LFSR_TAPS 0xe1
+
+.macro lfsr_byte
+    lds  r24, dds_lfsr          ; L
+    lds  r30, dds_lfsr+2        ; H
+    mov  r25, r24               ; M' = H ^ L<<1 ^ L<<6 ^ L<<7
+    lsl  r25
+    eor  r30, r25
+    mov  r25, r24
+    swap r25
+    andi r25, 0xf0
+    lsl  r25
+    lsl  r25
+    eor  r30, r25
+    lsl  r25
+    eor  r30, r25
+    mov  r31, r24               ; H' = L ^ L>>1 ^ L>>2 ^ L>>7
+    mov  r25, r24
+    lsr  r25
+    eor  r31, r25
+    lsr  r25
+    eor  r31, r25
+    clr  r25
+    bst  r24, 7
+    bld  r25, 0
+    eor  r31, r25
+    lds  r24, dds_lfsr+1        ; L' = M
+    sts  dds_lfsr, r24
+    sts  dds_lfsr+1, r30
+    sts  dds_lfsr+2, r31
+.endm
+
+/*--------- Interrupts ---------*/
+
+    .section .text.TIMER1_COMPA_vect,"ax",@progbits
+    .global TIMER1_COMPA_vect
+    .global dds_render_table
+    .global dds_render_qsine
+    .global dds_render_table_interp
+    .global dds_render_qsine_interp
+    .global dds_render_ram
+    .global dds_render_ram_interp
+    .global dds_render_stream
+    .global dds_render_rest
+    .global dds_render_white
+    .global dds_render_pink
+/**
+   Update output waveform.
+   PLEASE DO NOT ALTER without updating the cycle count above.
+*/
+TIMER1_COMPA_vect:
+#if DAC_BACKEND == DAC_SPI
+    sbi  io_bit(DAC_CS)         ; The DAC latches the frame sent last time
+    push r24
+    cbi  io_bit(DAC_CS)
+    lds  r24, dds_next+1        ; And the next one starts, MSB first
+    out  _SFR_IO_ADDR(SPDR), r24
+#else
+    push r24
+    lds  r24, dds_next
+    out  _SFR_IO_ADDR(DAC_PORT), r24
+#endif
+
+    in   r24, _SFR_IO_ADDR(SREG)
+    push r24
+    push r25
+    push r30
+    push r31
+
+#if DEBUG_PULSE_PIN_ISR == 1
+    sbi  io_bit(DEBG_PIN)
+#endif
+
+    /* Sweeping (sweep.h), ramp the tuning word first */
+    lds  r25, dds_sweeping
+    tst  r25
+    brne dds_sweep
+dds_sweep_done:
+
+    /* phase += tuning, wraps around by itself at 2^24 */
+    lds  r25, dds_tuning
+    in   r24, PHASE0
+    add  r24, r25
+    out  PHASE0, r24
+    lds  r25, dds_tuning+1
+    in   r24, PHASE1
+    adc  r24, r25
+    out  PHASE1, r24
+    lds  r25, dds_tuning+2
+    in   r24, PHASE2
+    adc  r24, r25
+    out  PHASE2, r24
+#if DAC_BACKEND == DAC_SPI
+    lds  r25, dds_next          ; The MSB is out by now, 16 cycles at fosc/2
+    out  _SFR_IO_ADDR(SPDR), r25
+#endif
+    brcs dds_wrap               ; Period boundary, see below
+dds_wrap_done:
+
+    /*
+      Render routines get the phase MSB in r24 and C set at the start of a
+      period (nothing on the way there touches C). They leave an 8 bit
+      sample in r24 for dds_render_done8, a WAVE_BITS one from the flash
+      tables in r25:r24 for dds_render_done (the same thing, with 8 bit
+      tables), or jump to dds_render_keep to hold the current one.
+    */
+    lds  r30, dds_render
+    lds  r31, dds_render+1
+    ijmp
+
+/**
+   tuning += slope, 24.8 fixed point with the fraction in dds_tuning_frac.
+   The slope is signed, the 32 bit add takes care of it. 31 more cycles
+   than not sweeping.
+*/
+dds_sweep:
+    lds  r24, dds_tuning_frac
+    lds  r25, dds_slope
+    add  r24, r25
+    sts  dds_tuning_frac, r24
+    lds  r24, dds_tuning
+    lds  r25, dds_slope+1
+    adc  r24, r25
+    sts  dds_tuning, r24
+    lds  r24, dds_tuning+1
+    lds  r25, dds_slope+2
+    adc  r24, r25
+    sts  dds_tuning+1, r24
+    lds  r24, dds_tuning+2
+    lds  r25, dds_slope+3
+    adc  r24, r25
+    sts  dds_tuning+2, r24
+    rjmp dds_sweep_done
+
+/**
+   Start of a new period (the phase add carried out). One more period of
+   the burst is done, if one is running (dds_burst is not 0). After the
+   last one the step queued by dds_step() plays, if there is one, or the
+   output rests until the next trigger. Then the parameter block published
+   by dds_publish() is taken, if there is one. Not taken, this costs 1
+   cycle.
+*/
+dds_wrap:
+    lds  r30, dds_burst
+    lds  r31, dds_burst+1
+    sbiw r30, 1
+    brcs dds_burst_done         ; Was 0, no burst
+    sts  dds_burst, r30
+    sts  dds_burst+1, r31
+    brne dds_burst_done
+    lds  r25, dds_step_ready
+    tst  r25
+    brne dds_next_step
+    ldi  r30, pm_lo8(dds_render_rest)
+    ldi  r31, pm_hi8(dds_render_rest)
+    sts  dds_render, r30
+    sts  dds_render+1, r31
+dds_burst_done:
+    sec                         ; The render routines get C set, sbiw cleared it
+    lds  r25, dds_params_new
+    tst  r25
+    breq dds_wrap_done
+
+/**
+   Take the block dds_params_new points at (1 + index), as dds_params_take()
+   in dds.c does: render routine (kept while resting between bursts), table
+   and, if flagged, tuning word. dds_publish() is done with the block by the
+   time it is pointed at, and the main loop can not run in between, so it is
+   all from the same update. r24 is the phase MSB, left alone, so all goes
+   through r25.
+*/
+#define PARAM_RENDER 0 /* ddsParams_t, dds.c */
+#define PARAM_TABLE  2
+#define PARAM_TUNING 4
+#define PARAM_WHAT   7
+
+    ldi  r30, lo8(dds_params)
+    ldi  r31, hi8(dds_params)
+    sbrc r25, 1                 ; 2, the second block
+    adiw r30, DDS_PARAMS_SIZE
+    lds  r25, dds_render
+    cpi  r25, pm_lo8(dds_render_rest)
+    brne 1f
+    lds  r25, dds_render+1
+    cpi  r25, pm_hi8(dds_render_rest)
+    breq 2f
+1:  ldd  r25, Z+PARAM_RENDER
+    sts  dds_render, r25
+    ldd  r25, Z+PARAM_RENDER+1
+    sts  dds_render+1, r25
+2:  ldd  r25, Z+PARAM_TABLE
+    sts  dds_table, r25
+    ldd  r25, Z+PARAM_TABLE+1
+    sts  dds_table+1, r25
+    ldd  r25, Z+PARAM_WHAT
+    sbrs r25, 0                 ; DDS_PARAM_TUNING
+    rjmp 3f
+    ldd  r25, Z+PARAM_TUNING
+    sts  dds_tuning, r25
+    ldd  r25, Z+PARAM_TUNING+1
+    sts  dds_tuning+1, r25
+    ldd  r25, Z+PARAM_TUNING+2
+    sts  dds_tuning+2, r25
+    clr  r25
+    sts  dds_tuning_frac, r25
+3:  clr  r25
+    sts  dds_params_new, r25
+    sec                         ; cpi may have cleared it
+    rjmp dds_wrap_done
+
+/**
+   Next step of a sequence: its render routine, table, tuning word and
+   length, all at once. The phase goes on, so the step starts at the
+   beginning of its period. r24 is the phase MSB, left alone.
+*/
+dds_next_step:
+    lds  r30, dds_step_render
+    lds  r31, dds_step_render+1
+    sts  dds_render, r30
+    sts  dds_render+1, r31
+    lds  r30, dds_step_table
+    lds  r31, dds_step_table+1
+    sts  dds_table, r30
+    sts  dds_table+1, r31
+    lds  r30, dds_step_tuning
+    lds  r31, dds_step_tuning+1
+    lds  r25, dds_step_tuning+2
+    sts  dds_tuning, r30
+    sts  dds_tuning+1, r31
+    sts  dds_tuning+2, r25
+    lds  r30, dds_step_periods
+    lds  r31, dds_step_periods+1
+    sts  dds_burst, r30
+    sts  dds_burst+1, r31
+    clr  r25
+    sts  dds_step_ready, r25
+    rjmp dds_burst_done
+
+/**
+   Full period table.
+*/
+dds_render_table:
+    table_index TAB_SIZE
+#if WAVE_BITS > 8
+    LD_TAB r24, Z+
+    LD_TAB r25, Z
+#else
+    LD_TAB r24, Z
+#endif
+
+#if DAC_BITS > 8
+dds_render_done:
+    lds  r30, dds_scaling       ; Amplitude or offset set, see below
+    tst  r30
+#else
+dds_render_done8:
+dds_render_done:
+    lds  r25, dds_scaling       ; Amplitude or offset set, see below
+    tst  r25
+#endif
+    brne dds_scale
+dds_scale_done:
+#if DAC_BACKEND == DAC_SPI
+    ori  r25, DAC_SPI_CMD
+    sts  dds_next, r24
+    sts  dds_next+1, r25
+#else
+    sts  dds_next, r24
+#endif
+dds_render_keep:
+
+#if DEBUG_PULSE_PIN_ISR == 1
+    cbi  io_bit(DEBG_PIN)
+#endif
+
+    pop  r31
+    pop  r30
+    pop  r25
+    pop  r24
+    out  _SFR_IO_ADDR(SREG), r24
+    pop  r24
+    reti
+
+#if DAC_BITS > 8
+/**
+   8 bit samples to the top 8 bits of the 12, then as the others.
+*/
+dds_render_done8:
+    mov  r25, r24
+    swap r24
+    andi r24, 0xf0
+    swap r25
+    andi r25, 0x0f
+    rjmp dds_render_done
+#endif
+
+/**
+   v = offset + (v - 128)*amplitude/256, saturated to 0-255. dds_offset is
+   kept as offset - 128 so both terms are signed. MULSU only takes r16-r23,
+   so the product is unsigned and fixed up for a negative v - 128. 26 more
+   cycles than not scaling, 28 when it clips. With AM on, amplitude comes
+   from dds_am instead.
+*/
+#if DAC_BITS > 8
+/*
+  The same for 12 bits: v = 2048 + dds_offset + (v - 2048)*amplitude/256,
+  saturated to 0-4095, with dds_offset 16 bits (offset - 128 times 16). The
+  product is unsigned again, fixed up for a negative v - 2048.
+*/
+dds_scale:
+    push r0
+    push r1
+    subi r25, 0x08              ; s = v - 2048
+    sbrc r30, DDS_SCALE_AM_BIT
+    rjmp dds_am                 ; a from the AM envelope
+    lds  r30, dds_amplitude
+dds_am_done:
+    mul  r24, r30               ; s LSB*a
+    mov  r31, r1
+    clr  r24
+    mul  r25, r30               ; s MSB*a
+    add  r31, r0
+    adc  r1, r24                ; r1:r31 = s*a/256, for an unsigned s
+    sbrc r25, 7
+    sub  r1, r30                ; Negative, - 256*a
+    lds  r24, dds_offset
+    lds  r25, dds_offset+1
+    add  r24, r31
+    adc  r25, r1
+    subi r25, -0x08             ; + 2048
+    cpi  r25, 0x10
+    brlo 1f                     ; 0-4095
+    clr  r24                    ; Clip, below 0 the MSB is negative
+    sbrs r25, 7
+    ser  r24
+    mov  r25, r24
+    andi r25, 0x0f
+1:
+    pop  r1
+    pop  r0
+    rjmp dds_scale_done
+#else
+dds_scale:
+    push r0
+    push r1
+    sbrc r25, DDS_SCALE_AM_BIT
+    rjmp dds_am                 ; a from the AM envelope
+    lds  r25, dds_amplitude
+dds_am_done:
+    subi r24, 0x80              ; v - 128
+    mul  r24, r25
+    sbrc r24, 7                 ; Negative, (v - 128 + 256)*a - 256*a
+    sub  r1, r25
+    lds  r24, dds_offset
+    add  r24, r1
+    brvc 1f
+    ldi  r24, 0x7f              ; Clip, to the side of the scaled sample
+    sbrc r1, 7
+    ldi  r24, 0x80
+1:
+    subi r24, 0x80              ; Back to 0-255
+    pop  r1
+    pop  r0
+    rjmp dds_scale_done
+#endif
+
+/**
+   AM (dds_set_am()): dds_am_phase += dds_am_step, and the amplitude is the
+   point of dds_am_env under the top 6 bits of the phase, left where
+   dds_scale wants it. r0 and r1 are saved by dds_scale. 29 more cycles than
+   the amplitude set with dds_set_level().
+*/
+#if DDS_AM_LEN != 64
+#error "dds_am takes the envelope index from the top 6 phase bits"
+#endif
+
+#if DAC_BITS > 8
+#define AM_AMP r30
+#else
+#define AM_AMP r25
+#endif
+
+dds_am:
+    lds  r0, dds_am_phase
+    lds  r1, dds_am_step
+    add  r0, r1
+    sts  dds_am_phase, r0
+    lds  r0, dds_am_phase+1
+    lds  r1, dds_am_step+1
+    adc  r0, r1
+    sts  dds_am_phase+1, r0
+    lds  r30, dds_am_phase+2
+    lds  r31, dds_am_step+2
+    adc  r30, r31
+    sts  dds_am_phase+2, r30
+    lsr  r30
+    lsr  r30
+    clr  r31
+    subi r30, lo8(-(dds_am_env))
+    sbci r31, hi8(-(dds_am_env))
+    ld   AM_AMP, Z
+    rjmp dds_am_done
+
+/**
+   Quarter wave sine, dds_table points to the SINE_LEN/4 point quarter.
+*/
+dds_render_qsine:
+    bst  r24, 7                 ; T = 2nd half, invert the value
+    in   r25, PHASE1
+#if SINE_LEN_LOG2 <= 10
+    /* i = phase[21:24-SINE_LEN_LOG2] */
+    lsl  r25
+    rol  r24
+    lsl  r25
+    rol  r24
+    .rept 10 - SINE_LEN_LOG2
+    lsr  r24
+    .endr
+    sbic PHASE2, 6              ; 2nd and 4th quadrants go backwards
+    com  r24
+#if SINE_LEN_LOG2 < 10
+    andi r24, (SINE_LEN/4 - 1)
+#endif
+    lds  r30, dds_table
+    lds  r31, dds_table+1
+    add  r30, r24
+    brcc 1f
+    inc  r31
+1:
+#if WAVE_BITS > 8
+    add  r30, r24
+    brcc 1f
+    inc  r31
+1:
+#endif
+#else
+    /* i = phase[21:13], 9 bits in r31:r24 */
+    clr  r31
+    lsl  r25
+    rol  r24
+    lsl  r25
+    rol  r24
+    lsl  r25
+    rol  r24
+    rol  r31
+    sbis PHASE2, 6              ; 2nd and 4th quadrants go backwards
+    rjmp 2f
+    com  r24
+    com  r31
+    andi r31, 0x01
+2:
+#if WAVE_BITS > 8
+    lsl  r24
+    rol  r31
+#endif
+    mov  r30, r24
+    lds  r24, dds_table
+    lds  r25, dds_table+1
+    add  r30, r24
+    adc  r31, r25
+#endif
+#if WAVE_BITS > 8
+    LD_TAB r24, Z+
+    LD_TAB r25, Z
+    brtc 3f
+    com  r24                    ; 2^WAVE_BITS - 1 - v
+    com  r25
+    andi r25, WAVE_MSB_MASK
+#else
+    LD_TAB r24, Z
+    brtc 3f
+    com  r24                    ; 255 - v
+#endif
+3:
+    rjmp dds_render_done
+
+/**
+   Full period table, interpolated. Reads the point under the phase and the
+   next one, the guard point at dds_table[WAVE_LEN] saves the wrap around.
+*/
+dds_render_table_interp:
+    push r0
+    push r1
+    push r26
+#if WAVE_BITS > 8
+    push r27
+    clt                         ; Nothing to invert
+    table_index_frac TAB_SIZE
+    LD_TAB r26, Z+              ; a = table[i]
+    LD_TAB r27, Z+
+    LD_TAB r24, Z+              ; b = table[i + 1]
+    LD_TAB r31, Z
+
+/*
+  The same with WAVE_BITS points, a in r27:r26 and b in r31:r24 (r27 saved
+  too): v = a + (b - a)*frac/256, the 16 bit difference times frac in two
+  unsigned MULs, fixed up for a negative one as dds_scale does.
+*/
+dds_lerp_w:
+    sub  r24, r26               ; d = b - a
+    sbc  r31, r27
+    mul  r24, r25               ; d LSB*frac
+    mov  r30, r1
+    clr  r24
+    mul  r31, r25               ; d MSB*frac
+    add  r30, r0
+    adc  r1, r24                ; r1:r30 = d*frac/256, for an unsigned d
+    sbrc r31, 7
+    sub  r1, r25                ; Negative, - 256*frac
+    add  r30, r26               ; + a
+    adc  r1, r27
+    mov  r24, r30
+    mov  r25, r1
+    brtc 2f
+    com  r24                    ; 2^WAVE_BITS - 1 - v
+    com  r25
+    andi r25, WAVE_MSB_MASK
+2:
+    pop  r27
+    pop  r26
+    pop  r1
+    pop  r0
+    rjmp dds_render_done
+#else
+    clt                         ; Nothing to invert
+    table_index_frac
+    LD_TAB r26, Z+              ; a = table[i]
+    LD_TAB r24, Z               ; b = table[i + 1]
+#endif
+
+/*
+  v = a + (b - a)*frac/256 = (a*(256 - frac) + b*frac)/256, with a in r26, b
+  in r24 and frac in r25. The sum never overflows 16 bits, so the partial
+  products can be added and subtracted in any order. v is inverted if T is
+  set. Uses the hardware multiplier, so r0 and r1 are saved on entry. 8 bit
+  points, only the RAM table's with the SPI DAC.
+*/
+dds_lerp:
+    mul  r24, r25               ; b*frac
+    movw r30, r0
+    mul  r26, r25               ; a*frac
+    sub  r30, r0
+    sbc  r31, r1
+    add  r31, r26               ; + a*256
+    mov  r24, r31
+    brtc 2f
+    com  r24                    ; 255 - v
+2:
+    pop  r26
+    pop  r1
+    pop  r0
+    rjmp dds_render_done8
+
+/**
+   Quarter wave sine, interpolated. dds_table points to the quarter, past
+   its leading guard point.
+
+   Going backwards (2nd and 4th quadrants) the next point is the one before
+   the current, which is the leading guard (the first point inverted) at the
+   end of the 2nd quadrant. Going forward the trailing guard repeats the
+   last point, the peak. The interpolation is done on the stored quarter and
+   the result inverted afterwards in the 3rd and 4th quadrants.
+*/
+dds_render_qsine_interp:
+    push r0
+    push r1
+    push r26
+#if WAVE_BITS > 8
+    push r27
+#endif
+    bst  r24, 7                 ; T = 2nd half, invert the value
+    in   r25, PHASE1
+#if SINE_LEN_LOG2 <= 10
+    /* i = phase[21:24-SINE_LEN_LOG2], frac = the next 8 bits in r25 */
+#if SINE_LEN_LOG2 > 8
+    in   r26, PHASE0
+    .rept SINE_LEN_LOG2 - 8
+    lsl  r26
+    rol  r25
+    rol  r24
+    .endr
+#endif
+    sbic PHASE2, 6              ; 2nd and 4th quadrants go backwards
+    com  r24
+#if SINE_LEN_LOG2 < 10
+    andi r24, (SINE_LEN/4 - 1)
+#endif
+    lds  r30, dds_table
+    lds  r31, dds_table+1
+    add  r30, r24
+    brcc 1f
+    inc  r31
+1:
+#if WAVE_BITS > 8
+    add  r30, r24
+    brcc 1f
+    inc  r31
+1:
+#endif
+#else
+    /* i = phase[21:13], 9 bits in r31:r24, frac = phase[12:5] in r25 */
+    in   r26, PHASE0
+    clr  r31
+    lsl  r26
+    rol  r25
+    rol  r24
+    lsl  r26
+    rol  r25
+    rol  r24
+    lsl  r26
+    rol  r25
+    rol  r24
+    rol  r31
+    sbis PHASE2, 6              ; 2nd and 4th quadrants go backwards
+    rjmp 2f
+    com  r24
+    com  r31
+    andi r31, 0x01
+2:
+#if WAVE_BITS > 8
+    lsl  r24
+    rol  r31
+#endif
+    mov  r30, r24
+    lds  r24, dds_table
+    lds  r26, dds_table+1
+    add  r30, r24
+    adc  r31, r26
+#endif
+    sbis PHASE2, 6
+    rjmp 3f
+#if WAVE_BITS > 8
+    LD_TAB r26, Z+              ; a = quarter[i]
+    LD_TAB r27, Z
+    sbiw r30, 3
+    LD_TAB r24, Z+              ; b = quarter[i - 1]
+    LD_TAB r31, Z
+    rjmp dds_lerp_w
+3:
+    LD_TAB r26, Z+              ; a = quarter[i]
+    LD_TAB r27, Z+
+    LD_TAB r24, Z+              ; b = quarter[i + 1]
+    LD_TAB r31, Z
+    rjmp dds_lerp_w
+#else
+    LD_TAB r26, Z               ; a = quarter[i]
+    sbiw r30, 1
+    LD_TAB r24, Z               ; b = quarter[i - 1]
+    rjmp dds_lerp
+3:
+    LD_TAB r26, Z+              ; a = quarter[i]
+    LD_TAB r24, Z               ; b = quarter[i + 1]
+    rjmp dds_lerp
+#endif
+
+/**
+   Full period table in RAM (the AWG waveform, see awg.h), with and without
+   interpolation.
+*/
+dds_render_ram:
+    table_index
+    ld   r24, Z
+    rjmp dds_render_done8
+
+dds_render_ram_interp:
+    push r0
+    push r1
+    push r26
+    clt
+    table_index_frac
+    ld   r26, Z+
+    ld   r24, Z
+    rjmp dds_lerp
+
+/**
+   Uart sample stream (see stream.h), one sample off the ring per period.
+*/
+dds_render_stream:
+    brcc dds_render_keep
+    lds  r25, stream_tail
+    lds  r24, stream_head
+    cp   r25, r24
+    breq 2f
+    ldi  r30, lo8(stream_buf)
+    ldi  r31, hi8(stream_buf)
+    add  r30, r25
+    brcc 1f
+    inc  r31
+1:
+    inc  r25                    ; Wraps at STREAM_LEN = 256
+    sts  stream_tail, r25
+    clr  r25
+    sts  stream_starved, r25
+    ld   r24, Z
+    rjmp dds_render_done8
+2:
+    /* Ran dry, hold the last sample and count it once */
+    lds  r25, stream_starved
+    tst  r25
+    brne dds_render_keep
+    ldi  r25, 1
+    sts  stream_starved, r25
+    lds  r24, stream_underruns
+    lds  r25, stream_underruns+1
+    adiw r24, 1
+    sts  stream_underruns, r24
+    sts  stream_underruns+1, r25
+    rjmp dds_render_keep
+
+/**
+   Between bursts: 128 is the offset once dds_render_done scales it, and
+   the offset is 128 when it does not.
+*/
+dds_render_rest:
+    ldi  r24, 0x80
+    rjmp dds_render_done8
+
+/**
+   White noise, 8 bits of the LFSR per sample.
+*/
+dds_render_white:
+    lfsr_byte
+    rjmp dds_render_done8
+
+/**
+   Pink noise, Voss-McCartney: the sum of 8 rows of random 0-15 values, one
+   row redrawn per sample, row k every 2^(k+1) samples (the trailing zeros of
+   dds_pink_count), plus a white term. Each row is an octave of white noise
+   held longer, the sum falls off 3 dB/octave down to SAMPLE_RATE/512, ~40
+   Hz at 20 kHz. The sum is kept in dds_pink_sum, so only the changed row is
+   read, and dds_pink_rows is aligned to 8 so the row address never carries.
+*/
+dds_render_pink:
+    lfsr_byte                   ; New row value in the high nibble, white in the low
+    lds  r25, dds_pink_count
+    inc  r25
+    sts  dds_pink_count, r25
+    mov  r31, r25               ; r25 = lowest bit set, 0 when the count wraps
+    neg  r31
+    and  r25, r31
+    ldi  r30, lo8(dds_pink_rows) ; + its position, by a binary search
+    mov  r31, r25
+    andi r31, 0xf0
+    breq 1f
+    subi r30, -4
+1:
+    mov  r31, r25
+    andi r31, 0xcc
+    breq 2f
+    subi r30, -2
+2:
+    mov  r31, r25
+    andi r31, 0xaa
+    breq 3f
+    subi r30, -1
+3:
+    ldi  r31, hi8(dds_pink_rows)
+    push r26
+    mov  r25, r24
+    swap r25
+    andi r25, 0x0f
+    ld   r26, Z                 ; sum += new row - old row
+    st   Z, r25
+    sub  r25, r26
+    lds  r26, dds_pink_sum
+    add  r26, r25
+    sts  dds_pink_sum, r26
+    andi r24, 0x0f
+    add  r24, r26               ; 0-135
+    pop  r26
+    mov  r25, r24               ; 2*(v - v/16), 0-254
+    swap r25
+    andi r25, 0x0f
+    sub  r24, r25
+    lsl  r24
+    rjmp dds_render_done8
+
+/*--------- EOF ---------*/
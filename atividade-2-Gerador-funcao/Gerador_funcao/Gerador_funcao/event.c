@@ -0,0 +1,171 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   event.c
+   @brief  Main loop events and idle sleep, see event.h.
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+#include <stdint.h>
+
+#include "event.h"
+
+/*--------- Globals ---------*/
+
+static volatile uint8_t events = 0; // Posted, not taken by event_wait() yet
+static volatile uint16_t posted_at; // event_clock() of the oldest of them
+static volatile uint8_t clock_hi = 0; // Timer2 overflows, event_clock() MSB
+static volatile uint8_t clock_pend = 0; // 1 while the ISR has not counted its overflow
+
+/*------ Statistics, only touched by the main loop ------*/
+static uint16_t last_at = 0; // event_clock() when last accounted for
+static uint32_t total = 0;   // Counts since event_stats()...
+static uint32_t idle = 0;    // ...and the ones asleep
+static uint16_t latency = 0; // Longest, counts
+
+/*--------- Function definition ---------*/
+/**
+   Timer2 as a 16 bit clock, EVENT_TICK_US per count, with interrupts off.
+   An overflow not counted yet is pending in TOV2: it came before TCNT2 was
+   read if TCNT2 is still low. One taken by the ISR that this call nests
+   into is flagged by clock_pend.
+*/
+static uint16_t event_clock(void)
+{
+    uint8_t lo = TCNT2;
+    uint8_t hi = clock_hi + clock_pend;
+    if((TIFR2 & (1 << TOV2)) && lo < 128) {
+        ++hi;
+    }
+    return (uint16_t)hi << 8 | lo;
+}
+
+/**
+   Start the clock and pick the sleep mode.
+*/
+void event_init(void)
+{
+    TCCR2A = 0x00; // Normal mode
+    TCCR2B = 0x06; // Presc = 256
+    TIMSK2 = 1 << TOIE2;
+    set_sleep_mode(SLEEP_MODE_IDLE);
+}
+
+/**
+   Post events (EVENT_*) for the main loop, from an ISR or from the main
+   loop itself to come back to something. A few cycles with interrupts off.
+*/
+void event_post(uint8_t ev)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if(!events) {
+            posted_at = event_clock();
+        }
+        events |= ev;
+    }
+}
+
+/**
+   Wait for events, sleeping until some are posted, and take them all.
+   Returns them, they are the main loop's to handle from now on.
+*/
+uint8_t event_wait(void)
+{
+    uint16_t now, slept = 0;
+    uint8_t ev;
+
+    cli();
+    now = event_clock();
+    total += (uint16_t)(now - last_at); // Main loop time, short by 2.1 s steps if longer (fast mode)
+    last_at = now;
+    while(!events) {
+        sleep_enable();
+        sei();
+        sleep_cpu(); // sei holds interrupts for one more instruction, a post can not slip in before
+        sleep_disable();
+        cli();
+        now = event_clock();
+        slept += now - last_at;
+        last_at = now;
+    }
+    ev = events;
+    events = 0;
+    uint16_t wait = now - posted_at;
+    sei();
+
+    total += slept;
+    idle += slept;
+    latency = wait > latency ? wait : latency;
+    return ev;
+}
+
+/**
+   How the main loop kept up since the last call, see event.h.
+*/
+void event_stats(eventStats_t * st)
+{
+    uint32_t t = total/100;
+    uint32_t i = t ? idle/t : 100;
+    st->idle = i < 100 ? i : 100;
+    st->latency = latency < UINT16_MAX/EVENT_TICK_US ? latency*EVENT_TICK_US : UINT16_MAX;
+    total = 0;
+    idle = 0;
+    latency = 0;
+}
+
+/*--------- Interrupts ---------*/
+/**
+   Clock MSB, every 8.2 ms. By hand, so it re-enables interrupts as early
+   as the others do (6 cycles in) and still can not be stopped half way by
+   one that posts: clock_pend flags the overflow before the sei, and is
+   cleared as clock_hi is incremented, with interrupts off for the last 9
+   cycles.
+*/
+ISR(TIMER2_OVF_vect, ISR_NAKED)
+{
+    __asm__ __volatile__ (
+        "push r24\n\t"
+        "ldi  r24, 1\n\t"
+        "sts  %[pend], r24\n\t"
+        "sei\n\t"
+        "in   r24, __SREG__\n\t"
+        "push r24\n\t"
+        "lds  r24, %[hi]\n\t"
+        "subi r24, 0xff\n\t"
+        "cli\n\t"
+        "sts  %[hi], r24\n\t"
+        "clr  r24\n\t"
+        "sts  %[pend], r24\n\t"
+        "pop  r24\n\t"
+        "out  __SREG__, r24\n\t" // I set again, it was when saved
+        "pop  r24\n\t"
+        "reti\n\t"
+        :: [hi] "i" (&clock_hi), [pend] "i" (&clock_pend)
+    );
+}
+
+/*--------- EOF ---------*/
@@ -0,0 +1,76 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   event.h
+   @brief  Main loop events and idle sleep.
+
+   The ISRs do not leave flags for the main loop to poll: they post event
+   bits with event_post(), and the main loop takes them all at once with
+   event_wait(), runs what they call for and waits again. With nothing
+   posted it sleeps in SLEEP_MODE_IDLE, where the timers, the uart and the
+   ADC keep running and any interrupt wakes it up. The sample ISR does not
+   post anything, the main loop just goes back to sleep after it.
+
+   Waking up adds 4 cycles to the response of the interrupt that did it,
+   where finishing the current instruction takes 0-3 otherwise, so the
+   sample clock jitters one cycle more at most (see dds_isr.s).
+
+   Two figures are kept to see how the loop keeps up, see event_stats():
+   the share of the time it sleeps (the ISRs that run meanwhile count as
+   idle, it is the main loop that is measured) and the longest time from a
+   post to event_wait() handing it over. Both are timed by Timer2, free
+   running at EVENT_TICK_US per count.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __EVENT_H__
+#define __EVENT_H__
+
+/*--- Includes ---*/
+
+#include <stdint.h>
+
+/*--- Constants ---*/
+
+#define EVENT_STATE (1 << 0) /*!< Start/stop button */
+#define EVENT_WAVE  (1 << 1) /*!< Wave button */
+#define EVENT_POT   (1 << 2) /*!< New pot reading, see adc_get() */
+#define EVENT_RX    (1 << 3) /*!< Uart byte: command, frame or sample */
+#define EVENT_TICK  (1 << 4) /*!< Timer0 overflow, every 8.2 ms */
+
+#define EVENT_TICK_US (32) /*!< Timer2 count, prescaler 256 at 8 MHz */
+
+/*--------- Types ---------*/
+
+typedef struct eventStats {
+    uint8_t idle;        /*!< % of the time the main loop slept */
+    uint16_t latency;    /*!< Longest post to event_wait(), us, saturates */
+} eventStats_t;
+
+/*--------- Prototype dec ---------*/
+
+void event_init(void);
+void event_post(uint8_t events);
+uint8_t event_wait(void);
+void event_stats(eventStats_t * st);
+
+#endif /* __EVENT_H__ */
+
+/*--------- EOF ---------*/
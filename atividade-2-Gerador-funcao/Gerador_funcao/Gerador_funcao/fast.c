@@ -0,0 +1,85 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   fast.c
+   @brief  Fast mode, see fast.h.
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/io.h>
+
+#include <stdint.h>
+
+#include "dds.h"
+#include "stream.h"
+
+#include "fast.h"
+
+/*--------- Constants ---------*/
+/*
+  Tuning word at FAST_RATE, f*2^24/10^6 = f*16.777216, as f*16 plus
+  f*0.777216 in 16 fraction bits (50936), which fits 32 bits for any f.
+*/
+#define FAST_TUNING(f) (((uint32_t)(f) << 4) + (((uint32_t)(f)*50936UL + 32768UL) >> 16))
+
+#if FAST_LEN != STREAM_LEN
+#error "The fast table is the stream ring, FAST_LEN must be STREAM_LEN"
+#endif
+
+/*--------- Globals ---------*/
+
+extern volatile uint8_t stream_buf[STREAM_LEN]; // The ring, stream.c
+
+static uint32_t tuning; // At FAST_RATE
+
+/*--------- Function definition ---------*/
+/**
+   Get w at f_hz ready for fast_run(). The table is the stream ring, aligned
+   for it, so not while streaming. Returns 0 if w is not played from a
+   table, or the DAC is not the parallel one.
+*/
+uint8_t fast_load(waveType_t w, uint16_t f_hz, uint8_t amplitude, uint8_t offset)
+{
+#if DAC_BACKEND == DAC_PARALLEL
+    tuning = FAST_TUNING(f_hz);
+    return dds_fill(w, tuning, amplitude, offset, (uint8_t *)stream_buf);
+#else
+    return 0; // A 16 bit SPI frame takes longer than a sample here
+#endif
+}
+
+/**
+   Play what fast_load() got ready, until a byte arrives on the uart or
+   BTN_SS is pressed. The sample ISR must be stopped and the uart TX drained
+   first, nothing is sent until it returns. Returns why it ended,
+   FAST_END_UART or FAST_END_BTN.
+*/
+uint8_t fast_run(void)
+{
+#if DAC_BACKEND == DAC_PARALLEL
+    return fast_loop((const uint8_t *)stream_buf, tuning);
+#else
+    return FAST_END_UART; // Never loaded
+#endif
+}
+
+/*--------- EOF ---------*/
@@ -0,0 +1,96 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   fast.h
+   @brief  Fast mode: a cycle counted loop plays the wave, no sample ISR.
+
+   The sample ISR spends ~75 cycles just getting in and out (dds_isr.s), so
+   the interrupt driven DDS tops out around 60 kHz. In fast mode the CPU
+   does nothing but play: fast_loop() (fast_loop.s) runs with interrupts
+   off, adds the tuning word to a 24 bit phase in registers and writes the
+   table point under its top byte to DAC_PORT, every FAST_CYCLES cycles
+   exactly:
+
+       add, adc, adc (phase += tuning)                     3
+       ld (table point, the phase top byte is the index)   2
+       out DAC_PORT                                        1
+       spare: uart / button poll or the loop jump          2
+                                                          ---
+                                                           8   FAST_RATE = 1 MHz
+
+   The loop is unrolled 4 samples, so the RX complete flag (RXC0) and the
+   BTN_SS interrupt flag (INTF1, falling edge, cleared on entry) are polled
+   every 4 samples. Either ends
+   fast mode: the byte stays in UDR0 and the button press stays pending,
+   both are handled as usual once interrupts are back on (so BTN_SS also
+   stops the generator).
+
+   The index has to be a single register, so the wave is played from a 256
+   point copy in RAM at a 256 byte boundary, made by dds_fill() from the
+   same tables the DDS plays. The rate is the same for every table length:
+
+     WAVE_LEN / SINE_LEN     copy                 sample rate
+     64, 128                 points repeated      1 MHz
+     256                     as is                1 MHz
+     512, 1024, 2048         every 2nd, 4th, 8th  1 MHz
+
+   A table of more than 256 points would need a 16 bit index, 2 more
+   cycles (800 kHz), and more RAM than there is. The frequency resolution
+   is FAST_RATE/2^24, 0.06 Hz. The copy uses the band limited level for the
+   frequency and the amplitude and offset set with 'a', so scaling costs
+   nothing here; there is no interpolation, sweep, modulation or list.
+
+   Fast mode needs the parallel DAC (see dac.h): a frame to the SPI DAC
+   takes 32 cycles at the least, so fast_load() refuses with the SPI one.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __FAST_H__
+#define __FAST_H__
+
+/*--- Constants ---*/
+
+#define FAST_CYCLES (8) /*!< CPU cycles per sample */
+#define FAST_RATE (8000000UL/FAST_CYCLES) /*!< Samples/s */
+#define FAST_LEN (256) /*!< Points in the table played */
+
+/* fast_loop() results, why it ended */
+#define FAST_END_UART (1)
+#define FAST_END_BTN  (2)
+
+#ifndef __ASSEMBLER__
+
+/*--- Includes ---*/
+
+#include <stdint.h>
+
+#include "dds.h"
+
+/*--------- Prototype dec ---------*/
+
+uint8_t fast_load(waveType_t w, uint16_t f_hz, uint8_t amplitude, uint8_t offset);
+uint8_t fast_run(void);
+uint8_t fast_loop(const uint8_t * table, uint32_t tuning);
+
+#endif /* __ASSEMBLER__ */
+
+#endif /* __FAST_H__ */
+
+/*--------- EOF ---------*/
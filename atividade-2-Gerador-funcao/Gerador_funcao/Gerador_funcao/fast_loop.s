@@ -0,0 +1,92 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   fast_loop.s
+   @brief  Fast mode output loop, hand written for a fixed cycle count.
+
+   See fast.h for the cycle count. Every sample takes FAST_CYCLES, from
+   one out to the next, whatever the spare slot after it does.
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/io.h>
+
+#include "dds.h"
+#include "fast.h"
+
+#if DAC_BACKEND == DAC_PARALLEL /* Not built for the SPI DAC, see fast.c */
+
+/*--------- Macros ---------*/
+
+/* One sample, 6 cycles: phase (r18, r19, r30) += tuning (r20, r21, r22) */
+.macro fast_sample
+    add  r18, r20
+    adc  r19, r21
+    adc  r30, r22
+    ld   r24, Z
+    out  _SFR_IO_ADDR(DAC_PORT), r24
+.endm
+
+/*--------- Functions ---------*/
+
+    .section .text.fast_loop,"ax",@progbits
+    .global fast_loop
+/**
+   uint8_t fast_loop(const uint8_t * table, uint32_t tuning)
+
+   table (r25:r24) is FAST_LEN points at a 256 byte boundary, tuning
+   (r23:r20) the 24 bit tuning word. Runs with interrupts off until the
+   uart or BTN_SS flag is set, returns FAST_END_UART or FAST_END_BTN.
+   PLEASE DO NOT ALTER without keeping every sample FAST_CYCLES long.
+*/
+fast_loop:
+    in   r27, _SFR_IO_ADDR(SREG)
+    cli
+    ldi  r26, 1 << INTF1        ; A stale BTN_SS flag would end the loop at once
+    out  _SFR_IO_ADDR(EIFR), r26
+    mov  r31, r25               ; Table page, the phase top byte is r30
+    clr  r30
+    clr  r19
+    clr  r18
+1:
+    fast_sample
+    lds  r25, _SFR_MEM_ADDR(UCSR0A) ; 2
+    fast_sample
+    sbrc r25, RXC0              ; 2 skipping
+    rjmp 2f
+    fast_sample
+    sbic _SFR_IO_ADDR(EIFR), INTF1 ; 2 skipping
+    rjmp 3f
+    fast_sample
+    rjmp 1b                     ; 2
+2:
+    ldi  r24, FAST_END_UART
+    rjmp 4f
+3:
+    ldi  r24, FAST_END_BTN
+4:
+    out  _SFR_IO_ADDR(SREG), r27
+    ret
+
+#endif /* DAC_PARALLEL */
+
+/*--------- EOF ---------*/
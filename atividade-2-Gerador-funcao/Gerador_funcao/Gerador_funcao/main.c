@@ -35,74 +35,45 @@
 #include <util/delay.h>
 #include <avr/pgmspace.h>
 #include <avr/interrupt.h>
+#include <util/atomic.h>
 
 #include <stdint.h>
 
-#include <stdio.h>
 #include <string.h>
 
 #include "util.h"
 
-/*--------- Macros ---------*/
-#define DEBUG_PULSE_PIN_ISR 0
-#define USE_PROGMEM 1
-
-#if USE_PROGMEM == 1
-#define TAB_ALLOC PROGMEM
-#else
-#define TAB_ALLOC
-#endif
+#include "dac.h"
+#include "dds.h"
+#include "awg.h"
+#include "stream.h"
+#include "uart.h"
+#include "status.h"
+#include "cmd.h"
+#include "proto.h"
+#include "adc.h"
+#include "sweep.h"
+#include "mod.h"
+#include "seq.h"
+#include "pulse.h"
+#include "fast.h"
+#include "event.h"
 
-#define set_2byte_reg(val, reg) reg ## H = (val >> 8); reg ## L = (val & 0xff);
-
-#define serial_debug(msg) uart_send_str(msg); uart_send_char('\r'); uart_send_char('\n');
+/*--------- Macros ---------*/
+#define serial_debug(msg) status_hide(); uart_send_str(msg); uart_send_char('\r'); uart_send_char('\n'); shown_status = 0;
+// Line ending of a reply sent in pieces, after status_hide() and the pieces
+#define serial_end() uart_send_char('\r'); uart_send_char('\n'); shown_status = 0;
 
 /*--------- Constants ---------*/
-#define CMD_BUFF_LEN 50
 #define BAUD_RATE (38400)
-#define WAVE_PTS (100)
-#define LUT_LEN (WAVE_PTS)
-#define MAX_F (100)
-/**
-   100 Point LUT's for all curves except the square.
-*/
-static const uint8_t sine_lut[LUT_LEN] TAB_ALLOC =
-{
-    127, 135, 143, 151, 159, 166, 174, 181, 188, 195, 202, 208, 214, 220, 225, 230,
-    235, 239, 242, 246, 248, 250, 252, 253, 254, 255, 254, 253, 252, 250, 248, 246,
-    242, 239, 235, 230, 225, 220, 214, 208, 202, 195, 188, 181, 174, 166, 159, 151,
-    143, 135, 127, 119, 111, 103, 95, 88, 80, 73, 66, 59, 52, 46, 40, 34, 29, 24,
-    19, 15, 12, 8, 6, 4, 2, 1, 0, 0, 0, 1, 2, 4, 6, 8, 12, 15, 19, 24, 29, 34, 40,
-    46, 52, 59, 66, 73, 80, 88, 95, 103, 111, 119
-};
-static const uint8_t trgl_lut[LUT_LEN] TAB_ALLOC =
-{
-    0, 5, 10, 15, 20, 25, 30, 35, 40, 45, 51, 56, 61, 66, 71, 76, 81, 86, 91, 96,
-    102, 107, 112, 117, 122, 127, 132, 137, 142, 147, 153, 158, 163, 168, 173, 178,
-    183, 188, 193, 198, 204, 209, 214, 219, 224, 229, 234, 239, 244, 249, 255, 249,
-    244, 239, 234, 229, 224, 219, 214, 209, 204, 198, 193, 188, 183, 178, 173, 168,
-    163, 158, 153, 147, 142, 137, 132, 127, 122, 117, 112, 107, 101, 96, 91, 86,
-    81, 76, 71, 66, 61, 56, 50, 45, 40, 35, 30, 25, 20, 15, 10, 5
-};
-static const uint8_t swtt_lut[LUT_LEN] TAB_ALLOC =
-{
-    255, 252, 249, 247, 244, 242, 239, 237, 234, 232, 229, 226, 224, 221, 219, 216,
-    214, 211, 209, 206, 204, 201, 198, 196, 193, 191, 188, 186, 183, 181, 178, 175,
-    173, 170, 168, 165, 163, 160, 158, 155, 153, 150, 147, 145, 142, 140, 137, 135,
-    132, 130, 127, 124, 122, 119, 117, 114, 112, 109, 107, 104, 102, 99, 96, 94,
-    91, 89, 86, 84, 81, 79, 76, 73, 71, 68, 66, 63, 61, 58, 56, 53, 50, 48, 45, 43,
-    40, 38, 35, 33, 30, 28, 25, 22, 20, 17, 15, 12, 10, 7, 5, 2
-};
+#define MIN_F (1)    /*!< Hz */
+#define MAX_F (2000) /*!< Hz, keeps >= 10 samples per period */
+#define POT_SPAN ((MAX_F - MIN_F)*1000UL) /*!< mHz, over the pot travel */
+#define POT_SCALE ((uint32_t)((POT_SPAN*2048ULL + ADC_MAX/2)/ADC_MAX)) /*!< mHz per pot LSB, 11 fraction bits, ADC_MAX*POT_SCALE < 2^32 */
+#define STREAM_MAX_RATE (BAUD_RATE/10) /*!< Samples/s the uart can carry (8N1) */
 
 /*--- Pins ---*/
-/*
-  Since we'll be using the whole PORTB, the processor needs to use the internal
-  oscillator so we can free the XTAL pins on PORTB.
- */
-#define DAC_PORT PORTB
-
 #define FREQ_ADJ_POT 7 /* DAC channel 7 */
-#define DEBG_PIN PORTC,2
 
 /*--- Buttons ---*/
 #define BTN_SS_vect   INT1_vect
@@ -125,35 +96,23 @@ typedef enum machineState {
     RUN,
 } machineState_t;
 
-typedef enum cmd {
-    CMD_STOP = 's',
-    CMD_RUN  = 'r',
-    CMD_CFG  = 'c',
-    CMD_HLP  = 'h'
-} cmd_t;
-
-typedef enum waveType {
-    WAVE_SINE = 's', /*!< Sine wave */
-    WAVE_SQRE = 'q', /*!< Square wave */
-    WAVE_SWTT = 'w', /*!< Sawtooth */
-    WAVE_TRGL = 't'  /*!< Triangle */
-} waveType_t;
-
 /*------ Functions ------*/
 /*------  Timer 1  ------*/
 void timer1_set_period_us(uint16_t t_us);
 inline void timer1_stop(void)  { TIMSK1 = 0x00; }
 inline void timer1_start(void) { TIMSK1 = 0x02; }
 
-/*------ UART ------*/
-void uart_init(uint32_t baudrate);
-void uart_send_char(const char c);
-void uart_send_str(const char * buff);
-
 /*------ Others ------*/
-void parse_cmd(char * _cmd_buff);
-uint8_t show_status(void);
-void delete_text(uint8_t len);
+cmdErr_t parse_cmd(const command_t * cmd, uint8_t verbose);
+void cmd_error(const command_t * cmd);
+void parse_frame(const protoFrame_t * frame);
+void list_stop(void);
+void pulse_end(void);
+void wave_button(void);
+void serial_rx(uint8_t c);
+void stream_restore(void);
+void serial_dec(uint16_t v);
+void serial_quoted(char c);
 
 /*--------- Globals ---------*/
 
@@ -162,39 +121,46 @@ static machineState_t major_state = STOP; // Machine state
 static uint8_t major_state_transition = 1;
 
 static waveType_t wave_type = WAVE_SQRE; // Current generator wave type
-uint16_t frequency = 10;
-uint16_t last_ADCread = 512;
+uint32_t frequency = 10000UL; // Output frequency, mHz
+static waveType_t stream_prev_wave; // Played before the stream, back to it at its end
+static uint32_t stream_prev_freq;
+static uint8_t interp = USE_INTERP; // Interpolate between table points
+static uint8_t amplitude = DDS_FULL_SCALE; // Output level, see dds_set_level()
+static uint8_t offset = 128;
 
 /*------ Counters ------*/
 volatile uint8_t t0_cnt = 0; // Timer0 interrupt counter
-volatile uint16_t lut_pos = 0; // Position in lookup table, used for sine gen
 
 /*------ Flags ------*/
 volatile uint8_t shown_status = 0;
-volatile uint8_t cmd_recved = 0;
-
-/*------ Buffers ------*/
-char cmd_buff[CMD_BUFF_LEN];
-char * cmd_buff_pos=cmd_buff;
-
-uint8_t last_status_len = 0;
+static uint8_t binary_mode = 0; // Last command came in a frame, no status line
 
 /*--------- Main ---------*/
 int main(void)
 {
     /* Set up pin directions */
-    DDRB = 0xff;
     DDRC = 0xff;
     DDRD = 0xf0;
+    dac_init();
+
+    // Before the sample clock runs, so they are taken at once
+    awg_init();
+    frequency = dds_set_wave_freq(wave_type, frequency);
 
     /* Configure timer 1 */
-    TCCR1A = 0x00; // Timer in normal mode,
-    TCCR1B = 0x02; // Presc = 8
+    /*
+      Fast PWM with TOP = OCR1A (mode 15), no output pins. Unlike CTC, OCR1A
+      is double buffered in this mode and only loaded at BOTTOM, so period
+      changes take effect at a sample boundary. The timer reloads itself,
+      the ISR never touches TCNT1.
+    */
+    TCCR1A = 0x03; // WGM11:10 = 11
+    TCCR1B = 0x1a; // WGM13:12 = 11, Presc = 8
     TIMSK1 = 0x02; // Enable Interrupt for OC1A
-    timer1_set_period_us(10000/frequency);
+    timer1_set_period_us(1000000UL/SAMPLE_RATE); // Fixed DDS sample clock
 
     // Configure pin interrupts
-    EICRA = 0x00; // Set both INT0 and INT1 as falling edge
+    EICRA = (1 << ISC11) | (1 << ISC01); // Set both INT0 and INT1 as falling edge
     EIMSK = 0x03; // Enable INT1 and INT0
 
     // Initialize uart
@@ -205,28 +171,38 @@ int main(void)
     TCCR0B = 0x04; // Presc = 256
     TIMSK0 = 0x01;
 
+    event_init(); // Timer2, the main loop clock
+
     __asm__("sei;"); // Enable interrupts
 
-    /* Configure ADC  */
-    ADMUX = 0b01000111; // Vref = pin AVCC (5V), ADC = pin ADC7
-    ADCSRA = 0b10000110; // Bit0: ADC enable, bits 2..0: prescaller
-    ADCSRA |= (1 << ADSC); // Starts first conversion
+    adc_init(FREQ_ADJ_POT); // Free running, filtered in its ISR
 
 
     uart_send_str("hello there!\r\n");
     set_bit(LED_ON);
 
     while(1) {
+        // Sleep until an ISR posts something, then run what it calls for
+        uint8_t ev = event_wait();
+
         // Do state transition actions or run steady state code
         if(major_state_transition) {
             switch(major_state) {
             case STOP:
-                timer1_stop();
-                DAC_PORT = 127; // Sets output to 0
+                if(wave_type == WAVE_PULSE) {
+                    pulse_output(0); // Timer1 is not the sample clock
+                } else {
+                    timer1_stop();
+                    dac_write(offset); // Sets output to 0
+                }
                 rst_bit(LED_RUN);
                 break;
             case RUN:
-                timer1_start();
+                if(wave_type == WAVE_PULSE) {
+                    pulse_output(1);
+                } else {
+                    timer1_start();
+                }
                 set_bit(LED_RUN);
                 switch(wave_type) {
                 case WAVE_SINE:
@@ -242,6 +218,7 @@ int main(void)
                     rst_bit(LED_SQRE);
                     break;
                 case WAVE_SQRE:
+                case WAVE_PULSE:
                     set_bit(LED_SQRE);
                     rst_bit(LED_SINE);
                     rst_bit(LED_SWTT);
@@ -253,137 +230,206 @@ int main(void)
                     rst_bit(LED_TRGL);
                     rst_bit(LED_SQRE);
                     break;
+                case WAVE_AWG:
+                case WAVE_STREAM:
+                case WAVE_WHITE:
+                case WAVE_PINK:
+                    rst_bit(LED_SINE);
+                    rst_bit(LED_SWTT);
+                    rst_bit(LED_TRGL);
+                    rst_bit(LED_SQRE);
+                    break;
                 }
                 break;
             }
             major_state_transition = 0; // Clear flag
+            event_post(EVENT_POT); // A reading taken while stopped
         }
-        else {
+        else if(ev & EVENT_POT) {
+            uint16_t pot;
             switch(major_state) {
             case STOP:
                 // Wait
                 break;
             case RUN:
-                // If conversion ended
-                if (ADCSRA & (1 << ADIF)) {
-                    uint32_t tmp = ADCW; // Read conversion
-                    if (tmp != last_ADCread) { // If the value changed since last read
-                        frequency = 10 + (((tmp * 90))/1023); // 0-1023 scale -> 10-100 scale
-                        last_ADCread = tmp & 0xffff;
-                        timer1_set_period_us(10000/frequency);
-                    }
-                    ADCSRA |= (1 << ADSC); // Starts next conversion
+                // New pot reading, the stream rate, pulses, sweeps and lists are not set by the pot
+                if (adc_get(&pot) && wave_type != WAVE_STREAM && wave_type != WAVE_PULSE &&
+                    !sweep_active() && !seq_active()) {
+                    // 0-ADC_MAX scale -> MIN_F-MAX_F scale, in mHz, without
+                    // a division. Only retunes if the tuning word changes
+                    uint32_t f = MIN_F*1000UL + ((pot*POT_SCALE + 1024) >> 11);
+                    frequency = dds_set_freq(f);
+                    mod_retune(); // The new FM carrier
                 }
                 break;
             }
         }
-        // Show status line
-        if (shown_status == 0) {
-            delete_text(last_status_len);
-            last_status_len = show_status();
-            shown_status = 1;
+        if(ev & EVENT_WAVE) {
+            wave_button();
+        }
+        if(!(ev & (EVENT_RX | EVENT_TICK))) {
+            continue; // The rest is the uart's and the tick's
         }
-        if(cmd_recved) {
-            parse_cmd(cmd_buff); // Parse incoming message
-            cmd_recved = 0;
+        // Flow control first, the ring fills up quickly. The sample ISR
+        // drains the ring without posting, the tick catches that
+        uint8_t flow = stream_flow();
+        if(flow) {
+            uart_send_ctrl(flow); // Ahead of anything queued
+        }
+        // Show status line, not while streaming (keeps the line free for flow control)
+        if ((ev & EVENT_TICK) && shown_status == 0 && !stream_active() && !binary_mode) {
+            if(sweep_active()) {
+                frequency = dds_get_freq(); // Where the sweep is
+            }
+            uint32_t f = mod_type() == MOD_FM ? dds_get_freq() : frequency; // Around the carrier
+            waveType_t w = wave_type;
+            const seqStep_t * step = seq_playing();
+            if(step) {
+                w = step->wave;
+                f = dds_get_freq();
+            }
+            genStatus_t st = {
+                major_state == RUN ? 'r' : 's', w, f, cmd_echo()
+            };
+            shown_status = status_show(&st); // Retried until there is room to send it
+        }
+        command_t cmd;
+        if(cmd_get(&cmd)) {
+            binary_mode = 0;
+            parse_cmd(&cmd, 1); // Run a command, one per pass
+            event_post(EVENT_RX); // Back for the next one and the state it set
+        }
+        const protoFrame_t * frame = proto_frame();
+        if(frame) {
+            if(!binary_mode) {
+                status_hide(); // Leave the terminal clean
+                binary_mode = 1;
+            }
+            parse_frame(frame);
+            event_post(EVENT_RX);
+        }
+        if(cmd_dropped()) {
+            serial_debug("cmd dropped, busy");
+        }
+        // Report waveform uploads
+        awg_poll();
+        switch(awg_result()) {
+        case AWG_NONE:
+            break;
+        case AWG_OK:
+            serial_debug("awg ok");
+            break;
+        case AWG_BAD_LEN:
+            serial_debug("awg bad length");
+            break;
+        case AWG_BAD_CRC:
+            serial_debug("awg crc error");
+            break;
+        case AWG_BUSY:
+            serial_debug("awg busy");
+            break;
+        case AWG_TIMED_OUT:
+            serial_debug("awg timeout");
+            break;
+        }
+        // Report the end of a one shot list
+        uint16_t late;
+        if(seq_ended(&late)) {
+            status_hide();
+            uart_send_str_P(PSTR("list done, late steps: "));
+            serial_dec(late);
+            serial_end();
+        }
+        // Report the end of a sample stream
+        streamStats_t stats;
+        if(stream_ended(&stats)) {
+            status_hide();
+            uart_send_str_P(PSTR("stream end, underruns: "));
+            serial_dec(stats.underruns);
+            uart_send_str(" overruns: "); // Only one flash string can be pending
+            serial_dec(stats.overruns);
+            serial_end();
+            stream_restore();
         }
     }
 }
 
 /*--------- Interrupts ---------*/
-/**
-   Update output waveform.
-   PLEASE DO NOT ALTER, as it alters the timing of the waveform generation
+/*
+  All the ISRs below re-enable interrupts as early as possible, so the sample
+  ISR (dds_isr.s) can preempt them and the sample clock does not jitter.
 */
-ISR(TIMER1_COMPA_vect)
-{
-    volatile uint8_t v;
-
-#if DEBUG_PULSE_PIN_ISR == 1
-    set_bit(DEBG_PIN);
-#endif
-
-    set_2byte_reg(0x0000, TCNT1); // Reset timer value
-    /*
-      Read wave value from ROM (progam memory), and set port output
-      (except for square wave).
-    */
-#if USE_PROGMEM == 1
-    switch(wave_type) {
-    case WAVE_SINE:
-        v = pgm_read_byte(sine_lut+lut_pos);
-        break;
-    case WAVE_TRGL:
-        v = pgm_read_byte(trgl_lut+lut_pos);
-        break;
-    case WAVE_SWTT:
-        v = pgm_read_byte(swtt_lut+lut_pos);
-        break;
-    case WAVE_SQRE:
-        v = lut_pos < (LUT_LEN>>1) ? 0 : 255;
-        break;
-    default:
-        v = 128;
-        break;
-    }
-#else // Uses RAM
-    switch(wave_type) {
-    case WAVE_SINE:
-        v = sine_lut[lut_pos];
-        break;
-    case WAVE_TRGL:
-        v = trgl_lut[lut_pos];
-        break;
-    case WAVE_SWTT:
-        v = swtt_lut[lut_pos];
-        break;
-    case WAVE_SQRE:
-        v = lut_pos < (LUT_LEN>>1) ? 0 : 255;
-        break;
-    default:
-        v = 128;
-        break;
-    }
-#endif
-
-    DAC_PORT = v;
-
-  // Increment LUT position ans tests if it should go back to 0
-    lut_pos = lut_pos < LUT_LEN - 1 ? lut_pos + 1 : 0;
-
-#if DEBUG_PULSE_PIN_ISR == 1
-    rst_bit(DEBG_PIN);
-#endif
-}
 
 /**
    Used to periodically (~100 ms) show a status line on the uart. (only sets a
    flag to show later
 */
-ISR(TIMER0_OVF_vect)
+ISR(TIMER0_OVF_vect, ISR_NOBLOCK)
 {
+    sweep_tick(); // First, the sweep schedule is the one in a hurry
+    mod_tick();
+    seq_tick();
+    awg_tick();
+    proto_tick();
+    stream_tick();
     ++t0_cnt;
     if(t0_cnt >= 100) {
         t0_cnt = 0;
         shown_status = 0;
     }
+    event_post(EVENT_TICK);
 }
 
 /**
    Start/stop button interrupt.
 */
-ISR(BTN_SS_vect)
+ISR(BTN_SS_vect, ISR_NOBLOCK)
 {
+    if(major_state == RUN && mod_trigger()) {
+        return; // Fires a burst instead, in burst mode
+    }
     major_state = major_state == RUN ? STOP : RUN;
     major_state_transition = 1;
+    event_post(EVENT_STATE);
     //while(get_bit(BTN_SS)); // Wait button release;
 }
 
 /**
-   Toggle waveformat types.
+   Toggle waveformat types, only flags the press: the wave is changed by the
+   main loop (see wave_button()), the only one that sets it.
+*/
+ISR(BTN_WAVE_vect, ISR_NOBLOCK)
+{
+    event_post(EVENT_WAVE);
+}
+
+/**
+   The stream ended, back to the wave played before it, unless the wave
+   button already moved on.
+*/
+void stream_restore(void)
+{
+    if(wave_type != WAVE_STREAM) {
+        return;
+    }
+    wave_type = stream_prev_wave;
+    if(wave_type == WAVE_PULSE) {
+        frequency = stream_prev_freq;
+        pulse_start(); // Still set up, see pulse_set()
+        pulse_output(major_state == RUN);
+    } else {
+        frequency = dds_set_wave_freq(wave_type, stream_prev_freq);
+    }
+}
+
+/**
+   Next wave of the button cycle, from the start of the next period
 */
-ISR(BTN_WAVE_vect)
+void wave_button(void)
 {
+    if(seq_active()) {
+        return; // The list sets the wave
+    }
     switch(wave_type) {
     case WAVE_SINE:
         wave_type = WAVE_TRGL;
@@ -395,70 +441,77 @@ ISR(BTN_WAVE_vect)
         wave_type = WAVE_SWTT;
         break;
     case WAVE_SWTT:
+        wave_type = awg_ready() ? WAVE_AWG : WAVE_WHITE; // Nothing uploaded to play yet
+        break;
+    case WAVE_AWG:
+        wave_type = WAVE_WHITE;
+        break;
+    case WAVE_WHITE:
+        wave_type = WAVE_PINK;
+        break;
+    case WAVE_PULSE:
+        pulse_end();
+        // The pulse frequency may be past what the DDS plays, retune too
+        wave_type = WAVE_SINE;
+        if(frequency > MAX_F*1000UL) {
+            frequency = MAX_F*1000UL;
+        }
+        frequency = dds_set_wave_freq(wave_type, frequency);
+        return;
+    case WAVE_PINK:
+    case WAVE_STREAM:
         wave_type = WAVE_SINE;
         break;
     }
-    lut_pos = 0;
+    dds_set_wave(wave_type);
 }
 
 /**
-   Handle serial data.
+   Handle serial data. The receivers run with interrupts back on, but with
+   RXCIE0 off: a nested RX ISR would hand them the next byte before this one.
 */
 ISR(USART_RX_vect) // Serial recieve
 {
-    *cmd_buff_pos = UDR0; // Save incoming char to buffer;
-
-    // Test buffer boundary
-    if (cmd_buff_pos + 1 >= (cmd_buff+CMD_BUFF_LEN)) {
-
-        cmd_buff_pos = cmd_buff; // Discard input
-        return;
-    }
-    *(cmd_buff_pos+1) = 0; // Null terminate string
-    shown_status = 0; // Flag to refresh status
-    // Test for end of command
-    if(*cmd_buff_pos == '\r') {
-        cmd_recved = 1;
-    }
-    ++cmd_buff_pos;
+    uint8_t c = UDR0;
+    UCSR0B &= ~(1 << RXCIE0); // Not reentrant, the next byte waits in UDR0
+    sei();
+    serial_rx(c);
+    cli();
+    UCSR0B |= (1 << RXCIE0); // A byte received meanwhile fires after reti
 }
 
 /*--------- Function definition  ---------*/
 /*---------   User interaction   ---------*/
 /**
-  delete text.
+   Hand a received byte to the receiver it belongs to, in arrival order
+   (see USART_RX_vect)
 */
-void delete_text(uint8_t len)
+void serial_rx(uint8_t c)
 {
-    // Delete previous text
-    for(uint8_t i = len; i; --i) {
-        uart_send_char(0x08); // Send Backspace
-    }
-}
+    event_post(EVENT_RX);
 
-/**
-   Show running status line.
-*/
-uint8_t show_status(void)
-{
-    const uint8_t bufflen = 150;
-    char buff[bufflen];
-    snprintf(buff, bufflen,
-             "---------------------------------\r"
-             "status: %c wavef: %c freq: %03iHz\r"
-             "cmd: %s\r"
-             "---------------------------------\r",
-             major_state == RUN ? 'r' : 's', wave_type, frequency, cmd_buff);
-    uart_send_str(buff);
-    return strnlen(buff, bufflen);
+    if(stream_rx(c)) {
+        return; // A sample
+    }
+    // Only one frame receiver may have a frame open, the other one would
+    // take its payload for a start of frame
+    if(!proto_receiving() && awg_rx(c)) {
+        return; // Part of a waveform upload frame
+    }
+    if(proto_rx(c)) {
+        return; // Part of a binary command frame
+    }
+    cmd_rx(c); // Parsed as it arrives, queued at the end of the line
+    shown_status = 0; // Flag to refresh status
 }
 
 /**
-   Parse received command
+   Run a command from the text parser (cmd.h) or a binary frame (proto.h),
+   replying in text only if verbose. Returns CMD_OK or why it was refused.
 */
-void parse_cmd(char * _cmd_buff)
+cmdErr_t parse_cmd(const command_t * cmd, uint8_t verbose)
 {
-    const char help_str[] =
+    static const char help_str[] PROGMEM =
 
         "-------------------------------------------------------\r"
         "h - help\r"
@@ -470,92 +523,479 @@ void parse_cmd(char * _cmd_buff)
         "\t  - q - s[q]uare\r"
         "\t  - w - sa[w]tooth\r"
         "\t  - t - [t]riangle\r"
-        "\t frequency: 10-100 Hz, integer\r"
+        "\t  - a - [a]rbitrary, uploaded as a binary frame (awg.h)\r"
+        "\t  - n - white [n]oise, p - [p]ink noise, freq is ignored\r"
+        "\t frequency: 1-2000 Hz, integer\r"
+        "\t or c u <freq> <duty>: p[u]lse on PB2 (OC1B), no CPU per edge\r"
+        "\t freq: 1-65535 Hz, duty: 0-100 %\r"
+        "i - toggle interpolation between table points\r"
+        "x - stream samples - format: x <rate>, then raw bytes\r"
+        "\t rate: 1-3840 samples/s, XON/XOFF flow control,\r"
+        "\t ends when the line is quiet for 0.5 s, back to the last wave\r"
+        "w - sweep the frequency - format: w <law> <start> <stop> <ms>\r"
+        "\t law: l - linear, g - logarithmic\r"
+        "\t start, stop: 1-2000 Hz, ms: 1-65535, repeats until c or x\r"
+        "a - output level - format: a <amplitude> <offset>\r"
+        "\t amplitude: 0-255, 255 is full scale, offset: 0-255, 128 is 0 V\r"
+        "m - modulation - format: m <mode> <a> <b>\r"
+        "\t a - AM, a: rate in 0.01 Hz (1-20000), b: depth 0-100 %\r"
+        "\t f - FM, a: rate in 0.01 Hz (1-1000), b: deviation in Hz\r"
+        "\t b - burst, a: periods, b: repeat ms, 0: t or SS btn only\r"
+        "\t   SS fires a burst instead of stopping, s or m o stop\r"
+        "\t o - off, no a and b\r"
+        "t - trigger a burst\r"
+        "l - list mode - format: l <waveType> <freq> <periods>, adds a step\r"
+        "\t or l <o|l|e|d>: play [o]nce, [l]oop, [e]nd, [d]elete steps\r"
+        "\t up to 16 steps, each at least 17 ms long\r"
+        "f - fast mode - format: f <freq>, the wave at 1 MSa/s\r"
+        "\t freq: 1-65535 Hz, no interp, sweep or modulation, runs\r"
+        "\t until any key or SS\r"
+        "binary command frames are also accepted, see proto.h\r"
         "-------------------------------------------------------\r";
 
-    cmd_t cmd = _cmd_buff[0];
-    cmd_buff_pos = cmd_buff;
-    char w = 0;
-    uint16_t f = 9999;
-    switch(cmd) {
+    if(cmd->err != CMD_OK) {
+        if(!verbose) {
+            return cmd->err;
+        }
+        cmd_error(cmd);
+        if(cmd->err != CMD_ERR_CMD) {
+            return cmd->err;
+        }
+    }
+    uint16_t f = cmd->num[0];
+    switch(cmd->cmd) {
     case CMD_RUN:
         major_state = RUN;
         major_state_transition = 1;
         break;
     case CMD_CFG:
-      // Reads text input to variables w & f
-        sscanf(_cmd_buff, "%*c %c %u\n", &w, &f);
-        if(w && (f <= 100) ) {
-            f = f < 10 ? 10 : f; // Sets f to 10 if f < 10, leaves otherwise
-            //f = f - (f%10); // Get closest power of ten
-            wave_type = w;
-            frequency = f;
+        if(cmd->letter == WAVE_PULSE && cmd->num[1] <= PULSE_MAX_DUTY) {
+            sweep_stop();
+            seq_stop();
+            mod_stop(); // Timer1 leaves the DDS altogether
+            wave_type = WAVE_PULSE;
+            frequency = pulse_set(f, cmd->num[1]); // The one actually set
+            pulse_start();
+            pulse_output(major_state == RUN);
+            if(verbose) {
+                serial_debug("ok");
+            }
+        } else if(cmd->letter == WAVE_AWG && !awg_ready()) {
+            if(verbose) {
+                serial_debug("no waveform uploaded yet");
+            }
+            return CMD_ERR_STATE;
+        } else if(cmd->letter != WAVE_PULSE && f <= MAX_F) {
+            f = f < MIN_F ? MIN_F : f; // Sets f to MIN_F if f < MIN_F, leaves otherwise
+            sweep_stop();
+            seq_stop(); // Wave and frequency set below
+            pulse_end();
+            wave_type = cmd->letter;
             /*
-              The timer frequency is 100 (Hz * 100 samples/sec) / f
+              The sample clock is fixed, only the DDS tuning word changes.
+              Wave and frequency go together, at the next period
             */
-            timer1_set_period_us(10000/f);
+            frequency = dds_set_wave_freq(wave_type, f*1000UL); // The one actually set
+            mod_retune(); // The new FM carrier
+            if(verbose) {
+                serial_debug("ok");
+            }
+        } else {
+            if(verbose) {
+                serial_debug(cmd->letter == WAVE_PULSE ? "duty out of range" : "freq out of range");
+            }
+            return CMD_ERR_RANGE;
+        }
+        break;
+    case CMD_STRM:
+        if(f && f <= STREAM_MAX_RATE) {
+            sweep_stop();
+            mod_stop(); // The stream plays the samples as sent
+            seq_stop();
+            if(wave_type != WAVE_STREAM) {
+                stream_prev_wave = wave_type;
+                stream_prev_freq = frequency;
+            }
+            pulse_end();
+            wave_type = WAVE_STREAM;
+            frequency = dds_set_wave_freq(wave_type, f*1000UL); // One sample per period
+            if(verbose) {
+                serial_debug("streaming");
+            }
+            stream_start(); // Bytes are samples from now on
+        } else {
+            if(verbose) {
+                serial_debug("rate out of range");
+            }
+            return CMD_ERR_RANGE;
+        }
+        break;
+    case CMD_SWEEP:
+        if(cmd->num[0] < MIN_F || cmd->num[0] > MAX_F ||
+           cmd->num[1] < MIN_F || cmd->num[1] > MAX_F) {
+            if(verbose) {
+                serial_debug("start or stop out of range");
+            }
+            return CMD_ERR_RANGE;
+        }
+        if(mod_type() == MOD_FM) {
+            mod_stop(); // Both would drive the tuning slope
+        }
+        list_stop();
+        if(wave_type == WAVE_STREAM || wave_type == WAVE_PULSE ||
+           !sweep_start(cmd->letter, cmd->num[0]*1000UL, cmd->num[1]*1000UL, cmd->num[2])) {
+            if(verbose) {
+                serial_debug("can not sweep that");
+            }
+            return CMD_ERR_RANGE;
+        }
+        if(verbose) {
+            serial_debug("sweeping");
+        }
+        break;
+    case CMD_AMPL:
+        if(cmd->num[0] > 255 || cmd->num[1] > 255) {
+            if(verbose) {
+                serial_debug("amplitude or offset out of range");
+            }
+            return CMD_ERR_RANGE;
+        }
+        amplitude = cmd->num[0];
+        offset = cmd->num[1];
+        mod_level(amplitude, offset);
+        if(major_state == STOP) {
+            dac_write(offset); // The level the output rests at
+        }
+        if(verbose) {
+            serial_debug("ok");
+        }
+        break;
+    case CMD_MOD:
+        if((wave_type == WAVE_STREAM || wave_type == WAVE_PULSE) && cmd->letter != MOD_OFF) {
+            if(verbose) {
+                serial_debug(wave_type == WAVE_STREAM ? "can not modulate a stream" :
+                             "can not modulate a pulse");
+            }
+            return CMD_ERR_STATE;
+        }
+        if(cmd->letter == MOD_FM) {
+            sweep_stop(); // Both would drive the tuning slope
+        }
+        if(cmd->letter != MOD_OFF) {
+            list_stop(); // Its steps would undo the modulation
+        }
+        if(!mod_start(cmd->letter, cmd->num[0], cmd->num[1])) {
+            if(verbose) {
+                serial_debug("can not modulate that");
+            }
+            return CMD_ERR_RANGE;
+        }
+        if(verbose) {
+            serial_debug(cmd->letter == MOD_OFF ? "modulation off" : "ok");
+        }
+        break;
+    case CMD_FAST:
+        if(major_state != RUN || seq_active() || stream_active()) {
+            if(verbose) {
+                serial_debug(major_state != RUN ? "run first" : "not while streaming or in list mode");
+            }
+            return CMD_ERR_STATE;
+        }
+        if(!fast_load(wave_type, f ? f : MIN_F, amplitude, offset)) {
+            if(verbose) {
+                serial_debug("can not play that fast");
+            }
+            return CMD_ERR_STATE;
+        }
+        if(verbose) {
+            serial_debug("fast mode, any key or SS to leave");
+        }
+        uart_flush(); // Nothing is sent in fast mode
+        timer1_stop();
+        fast_run();
+        timer1_start(); // A SS press is handled after this, and stops
+        if(verbose) {
+            serial_debug("fast mode off");
+        }
+        break;
+    case CMD_TRIG:
+        if(!mod_trigger()) {
+            if(verbose) {
+                serial_debug("not in burst mode");
+            }
+            return CMD_ERR_STATE;
+        }
+        if(verbose) {
             serial_debug("ok");
+        }
+        break;
+    case CMD_LIST:
+        switch(cmd->letter) {
+        case SEQ_ONCE:
+        case SEQ_LOOP:
+            if(wave_type == WAVE_STREAM || wave_type == WAVE_PULSE) {
+                if(verbose) {
+                    serial_debug(wave_type == WAVE_STREAM ? "stop the stream first" :
+                                 "leave pulse mode first");
+                }
+                return CMD_ERR_STATE;
+            }
+            sweep_stop();
+            mod_stop();
+            if(!seq_start(cmd->letter == SEQ_LOOP)) {
+                if(verbose) {
+                    serial_debug("list empty");
+                }
+                return CMD_ERR_STATE;
+            }
+            break;
+        case SEQ_END:
+            list_stop();
+            break;
+        case SEQ_CLEAR:
+            list_stop();
+            seq_clear();
+            break;
+        default: // A step
+            if(cmd->num[0] < MIN_F || cmd->num[0] > MAX_F ||
+               !seq_add(cmd->letter, cmd->num[0], cmd->num[1])) {
+                if(verbose) {
+                    serial_debug("list full or step out of range");
+                }
+                return CMD_ERR_RANGE;
+            }
+            break;
+        }
+        if(verbose) {
+            serial_debug("ok");
+        }
+        break;
+    case CMD_INTP:
+        interp = !interp;
+        dds_set_interp(interp);
+        if(!verbose) {
+            break;
+        }
+        if(interp) {
+            serial_debug("interp on");
         } else {
-            serial_debug("invalid arg");
+            serial_debug("interp off");
         }
         break;
     case CMD_STOP:
         major_state = STOP;
         major_state_transition = 1;
-        serial_debug("stopped");
+        if(verbose) {
+            serial_debug("stopped");
+        }
         break;
-    default:
-        serial_debug("invalid cmd");
+    default: // Unknown command, already reported
     case CMD_HLP:
-        uart_send_str(help_str);
-        last_status_len = 0; //No status line to delete
+        if(verbose) {
+            status_hide();
+            uart_send_str_P(help_str); // Sent from flash, does not fill the ring
+            shown_status = 0;
+        }
         break;
     }
-    *cmd_buff_pos = 0; // Reset cmd buffer
+    return CMD_OK;
+}
+
+/**
+   Run the records of a binary frame in order, up to the first one refused,
+   and reply (proto.h)
+*/
+void parse_frame(const protoFrame_t * frame)
+{
+    if(frame->err) {
+        proto_reply(frame->err, 0, NULL);
+        return;
+    }
+    protoState_t st;
+    protoState_t * query = NULL;
+    command_t cmd;
+    uint8_t pos = 0;
+    uint8_t index = 0;
+    cmdErr_t err = CMD_OK;
+    while(proto_next(frame, &pos, &cmd)) {
+        if(cmd.err == CMD_OK && cmd.cmd == CMD_QUERY) {
+            st.state = major_state == RUN ? 'r' : 's';
+            st.wave = seq_playing() ? seq_playing()->wave : wave_type;
+            st.interp = interp;
+            st.flags = (stream_active() ? PROTO_STREAMING : 0) |
+                (sweep_active() ? PROTO_SWEEPING : 0) |
+                (seq_active() ? PROTO_LIST : 0);
+            st.freq = sweep_active() || mod_type() == MOD_FM || seq_playing() ?
+                dds_get_freq() : frequency;
+            st.amplitude = amplitude;
+            st.offset = offset;
+            st.mod = mod_type();
+            eventStats_t es;
+            event_stats(&es);
+            st.idle = es.idle;
+            st.latency = es.latency;
+            query = &st;
+        } else {
+            err = parse_cmd(&cmd, 0);
+        }
+        if(err != CMD_OK) {
+            break;
+        }
+        ++index;
+    }
+    proto_reply(err, index, query);
 }
 
+/**
+   Stop the list, if one plays or has played, and go back to the wave and
+   frequency set before it
+*/
+void list_stop(void)
+{
+    if(!seq_active()) {
+        return;
+    }
+    seq_stop();
+    frequency = dds_set_wave_freq(wave_type, frequency);
+}
 
-/*------ Timer1 ------*/
-void timer1_set_period_us(uint16_t t_us)
+/**
+   Leave pulse mode, Timer1 is the sample clock again. The caller sets the
+   wave.
+*/
+void pulse_end(void)
 {
-    const uint8_t tmr1_ofs = 5; // Adjusted by hand from the ISR exec time
-    const uint16_t maxt_us = 0xffff; // Divide by 2
-    // Test for greatest period that fits in OCreg
-    t_us = t_us > (maxt_us) ? (maxt_us) :
-        (t_us <= tmr1_ofs ? tmr1_ofs + 1 : t_us);
-    /**
-       For a prescaler of 8 and clock of 16000000UL, every period is = 0.5 us
-       so the compare value is 2*t_us
-    */
-    uint16_t OCval = (t_us) - tmr1_ofs;
-    set_2byte_reg(OCval, OCR1A); // Set output compare high and low byte
+    if(!pulse_active()) {
+        return;
+    }
+    pulse_stop();
+    if(major_state == RUN) {
+        timer1_start();
+    } else {
+        dac_write(offset); // As stopped
+    }
 }
 
-/*--------- UART ---------*/
-void uart_send_str(const char * buff)
+/**
+   Report a parse error, naming the field it is in
+*/
+void cmd_error(const command_t * cmd)
 {
-    // Increment pointer until found null byte
-    for(;*buff;++buff)
-    {
-        uart_send_char(*buff);
+    static const char * const cfg_fields[] = { "wave", "freq", "duty" };
+    static const char * const sweep_fields[] = { "law", "start", "stop", "ms" };
+    static const char * const level_fields[] = { "amplitude", "offset" };
+    static const char * const am_fields[] = { "mode", "rate", "depth" };
+    static const char * const fm_fields[] = { "mode", "rate", "deviation" };
+    static const char * const burst_fields[] = { "mode", "periods", "ms" };
+    static const char * const list_fields[] = { "wave", "freq", "periods" };
+    uint8_t n = cmd->field;
+    const char * field;
+    switch(cmd->cmd) {
+    case CMD_CFG:
+        n = cmd->letter == WAVE_PULSE ? (n < 3 ? n : 2) : (n < 2 ? n : 1); // Past the end for CMD_ERR_EXTRA
+        field = cfg_fields[n];
+        break;
+    case CMD_STRM:
+        field = "rate";
+        break;
+    case CMD_FAST:
+        field = "freq";
+        break;
+    case CMD_SWEEP:
+        field = sweep_fields[n < 4 ? n : 3];
+        break;
+    case CMD_AMPL:
+        field = level_fields[n < 2 ? n : 1];
+        break;
+    case CMD_MOD:
+        n = n < 3 ? n : 2;
+        field = cmd->letter == MOD_AM ? am_fields[n] :
+            cmd->letter == MOD_FM ? fm_fields[n] :
+            cmd->letter == MOD_BURST ? burst_fields[n] : "mode";
+        break;
+    case CMD_LIST:
+        field = list_fields[n < 3 ? n : 2];
+        break;
+    default:
+        field = "cmd";
+        break;
     }
+    if(cmd->err == CMD_OK || cmd->err == CMD_ERR_STATE) {
+        return; // CMD_ERR_STATE is reported by parse_cmd()
+    }
+    // In pieces, no printf: one flash string each at most, see uart_send_str_P()
+    status_hide();
+    switch(cmd->err) {
+    case CMD_ERR_CMD:
+        uart_send_str_P(PSTR("invalid cmd "));
+        serial_quoted(cmd->bad);
+        break;
+    case CMD_ERR_LETTER:
+        uart_send_str_P(PSTR("invalid "));
+        uart_send_str(field);
+        uart_send_char(' ');
+        serial_quoted(cmd->bad);
+        break;
+    case CMD_ERR_NUM:
+        uart_send_str_P(PSTR("invalid "));
+        uart_send_str(field);
+        uart_send_str(", ");
+        serial_quoted(cmd->bad);
+        uart_send_str(" is not a digit");
+        break;
+    case CMD_ERR_RANGE:
+        uart_send_str(field);
+        uart_send_str_P(PSTR(" too large"));
+        break;
+    case CMD_ERR_MISSING:
+        uart_send_str_P(PSTR("missing "));
+        uart_send_str(field);
+        break;
+    case CMD_ERR_EXTRA:
+        uart_send_str_P(PSTR("unexpected "));
+        serial_quoted(cmd->bad);
+        uart_send_str(" after ");
+        uart_send_str(field);
+        break;
+    default:
+        break;
+    }
+    serial_end();
 }
 
-void uart_send_char(const char c)
+/**
+   v in decimal, part of a reply sent in pieces.
+*/
+void serial_dec(uint16_t v)
+{
+    char buff[6];
+    uart_send_str(status_dec(buff, v));
+}
+
+/**
+   'c', part of a reply sent in pieces.
+*/
+void serial_quoted(char c)
 {
-    /* Wait for empty transmit buffer */
-    while (!(UCSR0A & (1<<UDRE0)));
-        UDR0 = c;
+    uart_send_char('\'');
+    uart_send_char(c);
+    uart_send_char('\'');
 }
 
-void uart_init(uint32_t baudrate)
+
+/*------ Timer1 ------*/
+void timer1_set_period_us(uint16_t t_us)
 {
-    // Configure uart
-    UCSR0B = (1 << TXEN0)|(1 << RXEN0); // Enable serial RX and TX
-    UCSR0B |= (1 << RXCIE0); // Enable serial reception on interruption
-    UCSR0C = (1 << UCSZ00) | (1 << UCSZ01); // 8bits per frame
-    UBRR0H = (((F_CPU / ((uint32_t)16 * baudrate) ) - 1) >> 8);
-    UBRR0L = ((F_CPU / ((uint32_t)16 * baudrate) ) - 1); // Modo Normal Assíncrono;
+    t_us = t_us ? t_us : 1;
+    /**
+       For a prescaler of 8 and clock of 8000000UL, every count is 1 us and
+       the timer counts OCR1A + 1 times per period. The new value is only
+       loaded at the end of the running period, so there are no runt samples.
+    */
+    uint16_t OCval = t_us - 1;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        set_2byte_reg(OCval, OCR1A); // Both bytes through TEMP, no ISR may write in between
+    }
 }
 
 /*--------- EOF ---------*/
@@ -0,0 +1,249 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   mod.c
+   @brief  AM, FM and burst modulation, see mod.h.
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include <stdint.h>
+
+#include "dds.h"
+#include "sweep.h"
+
+#include "mod.h"
+
+#ifndef F_CPU
+#define F_CPU 8000000UL
+#endif
+
+/*
+  Oscillator phase step per tick for 0.01 Hz, a full turn being 2^32:
+  2^32 * SWEEP_TICK_CYCLES / (100 * F_CPU), rounded at compile time.
+*/
+#define RATE_STEP ((uint32_t)(((1ULL << 48) + 50*F_CPU)/(100*F_CPU)))
+
+#if SWEEP_TICK_CYCLES != 65536UL
+#error "RATE_STEP assumes 2^16 cycle ticks"
+#endif
+
+/*
+  AM envelope phase step per sample for 0.01 Hz, Q8, a full turn being
+  2^PHASE_BITS: 2^(PHASE_BITS + 8) / (100 * SAMPLE_RATE), rounded.
+*/
+#define AM_RATE_STEP ((uint32_t)(((1ULL << (PHASE_BITS + 8)) + 50*SAMPLE_RATE)/(100*SAMPLE_RATE)))
+
+/*--------- Globals ---------*/
+/*
+  Set up by mod_start() with the modulation off, then only used by
+  mod_tick(), except for the AM envelope and the carrier.
+*/
+static volatile modType_t type = MOD_OFF;
+static uint32_t phase;    // FM, modulating oscillator
+static uint32_t step;     // FM, phase per tick
+static uint16_t depth;    // AM, depth/2, Q16
+static uint8_t amplitude = DDS_FULL_SCALE; // AM, the level at the peaks
+static uint32_t carrier;  // FM, tuning word, 24.8
+static uint32_t dev;      // FM, deviation, 24.8
+static uint16_t periods;  // Burst length
+static uint16_t every;    // Burst repeat, ticks, 0 for none
+static uint16_t countdown; // Ticks to the next repeat
+
+/*--------- Function definition ---------*/
+/**
+   sin(2*pi*x/2^16) in Q15. A parabola refined once (y += 0.225*(y*|y| -
+   y)), within 0.1% of full scale, integer math only.
+*/
+static int16_t mod_sine(uint16_t x)
+{
+    int32_t p = (int16_t)x; // -pi..pi
+    int32_t ap = p < 0 ? -p : p;
+    int32_t y = (p*(32768 - ap)) >> 13; // 4x(1 - |x|)
+    int32_t ay = y < 0 ? -y : y;
+    y += ((((y*ay) >> 15) - y)*7373) >> 15;
+    return y > 32767 ? 32767 : y < -32767 ? -32767 : y;
+}
+
+/**
+   Fill the AM envelope for the level and depth set: one period of the
+   gain 1 - depth*(1 - sin)/2 (Q15) times the amplitude.
+*/
+static void mod_am_fill(void)
+{
+    for(uint8_t i = 0; i < DDS_AM_LEN; ++i) {
+        int16_t s = mod_sine((uint16_t)i << 10);
+        uint16_t dip = ((uint32_t)(32768L - s)*depth) >> 16;
+        dds_set_am_point(i, ((uint32_t)amplitude*(32768U - dip)) >> 15);
+    }
+}
+
+/**
+   Start a modulation, see modType_t for a and b, the rate in 0.01 Hz.
+   Returns 0 if it can not be done: a rate of 0 or over MOD_MAX_RATE (AM)
+   or MOD_FM_MAX_RATE (FM), an AM depth over MOD_MAX_DEPTH, an FM deviation larger than the carrier or
+   reaching over Nyquist, a burst of 0 periods. MOD_OFF just stops.
+*/
+uint8_t mod_start(modType_t t, uint16_t a, uint16_t b)
+{
+    mod_stop();
+
+    switch(t) {
+    case MOD_AM:
+        if(!a || a > MOD_MAX_RATE || b > MOD_MAX_DEPTH) {
+            return 0;
+        }
+        depth = ((uint32_t)b << 16)/(2*MOD_MAX_DEPTH);
+        mod_am_fill();
+        type = t;
+        dds_set_am(((uint32_t)a*AM_RATE_STEP) >> 8);
+        return 1;
+    case MOD_FM:
+        if(!a || a > MOD_FM_MAX_RATE) {
+            return 0;
+        }
+        carrier = dds_get_tuning();
+        dev = dds_freq_to_tuning(b*1000UL);
+        if(dev > carrier || carrier + dev > dds_freq_to_tuning(DDS_MAX_MHZ)) {
+            return 0;
+        }
+        break;
+    case MOD_BURST:
+        if(!a) {
+            return 0;
+        }
+        periods = a;
+        every = ((uint32_t)b*(F_CPU/1000)) >> 16;
+        every = every || !b ? every : 1;
+        countdown = 1; // The first burst at the next tick
+        dds_set_burst(1);
+        type = t;
+        return 1;
+    case MOD_OFF:
+        return 1;
+    default:
+        return 0;
+    }
+    step = a*RATE_STEP;
+    phase = 0;
+    type = t;
+    return 1;
+}
+
+/**
+   Back to the plain wave: the level set, the carrier, no bursts.
+*/
+void mod_stop(void)
+{
+    modType_t was = type;
+    type = MOD_OFF;
+    switch(was) {
+    case MOD_AM:
+        dds_set_am(0); // Back to the amplitude set
+        break;
+    case MOD_FM:
+        dds_set_slope(0, carrier);
+        dds_set_tuning(carrier);
+        break;
+    case MOD_BURST:
+        dds_set_burst(0);
+        break;
+    case MOD_OFF:
+        break;
+    }
+}
+
+modType_t mod_type(void)
+{
+    return type;
+}
+
+/**
+   Set the output level, see dds_set_level(). With AM on the amplitude is
+   the one at the peaks, the envelope is filled again.
+*/
+void mod_level(uint8_t amp, uint8_t off)
+{
+    amplitude = amp;
+    dds_set_level(amp, off);
+    if(type == MOD_AM) {
+        mod_am_fill();
+    }
+}
+
+/**
+   The frequency was set, make it the FM carrier. The deviation is cut
+   down if it no longer fits.
+*/
+void mod_retune(void)
+{
+    if(type != MOD_FM) {
+        return;
+    }
+    uint32_t c = dds_get_tuning();
+    uint32_t top = dds_freq_to_tuning(DDS_MAX_MHZ) - c;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        carrier = c;
+        dev = dev > c ? c : dev;
+        dev = dev > top ? top : dev;
+    }
+}
+
+/**
+   Fire a burst, returns 0 if not in burst mode.
+*/
+uint8_t mod_trigger(void)
+{
+    if(type != MOD_BURST) {
+        return 0;
+    }
+    dds_trigger(periods);
+    return 1;
+}
+
+/**
+   Advance the modulation, to be called on every Timer0 overflow, after
+   sweep_tick(). Works out the tuning word for the next tick, or fires
+   the repeated bursts.
+*/
+void mod_tick(void)
+{
+    if(type == MOD_BURST) {
+        if(every && !--countdown) {
+            countdown = every;
+            dds_trigger(periods);
+        }
+        return;
+    }
+    if(type != MOD_FM) {
+        return;
+    }
+    phase += step;
+    int16_t s = mod_sine(phase >> 16);
+    // carrier + dev*s, split so the product fits 32 bits (dev < 2^30)
+    int32_t d = (int32_t)(dev >> 15)*s + (((int32_t)(dev & 0x7fff)*s) >> 15);
+    sweep_ramp(carrier + d);
+}
+
+/*--------- EOF ---------*/
@@ -0,0 +1,83 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   mod.h
+   @brief  AM, FM and burst modulation.
+
+   AM and FM follow a sine from a second, low rate oscillator:
+
+   - AM scales the output by 1 - depth*(1 - sin)/2: the peaks are at the
+     level set with 'a', the troughs depth % below it. The gain is worked
+     out once, as a 64 point envelope (dds_set_am_point()), and the sample
+     ISR steps through it every sample (dds_set_am()), up to MOD_MAX_RATE.
+   - FM moves the tuning word around the carrier (the frequency when it
+     started, or set after) by up to the deviation, up to MOD_FM_MAX_RATE.
+     mod_tick() advances it on every Timer0 overflow, as the sweep is
+     (SWEEP_TICK_CYCLES, 8.2 ms), and it rides on the sweep ramps
+     (sweep_ramp()): the sample ISR steps the tuning word every sample and
+     follows the sine in straight segments of one tick, at least 12 per
+     modulation period. The phase stays continuous.
+
+   Burst: the output rests at the offset, and every trigger (mod_trigger(),
+   from the BTN_SS button or the 't' command) plays a number of whole
+   periods from the start of the wave, counted in the sample ISR. Triggers
+   can also repeat on their own. BTN_SS then fires a burst instead of
+   stopping the output, 's' or 'm o' stop it.
+
+   Only one mode runs at a time, and FM and sweeps exclude each other, both
+   drive the tuning slope.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __MOD_H__
+#define __MOD_H__
+
+/*--- Includes ---*/
+
+#include <stdint.h>
+
+/*--- Constants ---*/
+
+#define MOD_MAX_RATE    (20000) /*!< AM, 0.01 Hz units, 100 samples per period */
+#define MOD_FM_MAX_RATE (1000)  /*!< FM, 0.01 Hz units, 12 ticks per period */
+#define MOD_MAX_DEPTH   (100)   /*!< AM, % */
+
+/*--------- Types ---------*/
+
+typedef enum modType {
+    MOD_OFF   = 'o',
+    MOD_AM    = 'a', /*!< rate, depth % */
+    MOD_FM    = 'f', /*!< rate, deviation Hz */
+    MOD_BURST = 'b'  /*!< periods, repeat every ms or 0 for triggers only */
+} modType_t;
+
+/*--------- Prototype dec ---------*/
+
+uint8_t mod_start(modType_t type, uint16_t a, uint16_t b);
+void mod_stop(void);
+modType_t mod_type(void);
+void mod_level(uint8_t amplitude, uint8_t offset);
+void mod_retune(void);
+uint8_t mod_trigger(void);
+void mod_tick(void);
+
+#endif /* __MOD_H__ */
+
+/*--------- EOF ---------*/
@@ -0,0 +1,303 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   proto.c
+   @brief  Binary command protocol, see proto.h.
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include "dds.h"
+#include "uart.h"
+
+#include "proto.h"
+
+/*--------- Types ---------*/
+
+typedef enum protoRxState {
+    RX_IDLE = 0, /*!< Waiting for PROTO_SOF, other bytes are not ours */
+    RX_SEQ,
+    RX_LEN,
+    RX_DATA,
+    RX_CRC0,
+    RX_CRC1,
+    RX_SKIP      /*!< Bad length, eat bytes until the line goes quiet */
+} protoRxState_t;
+
+/*--------- Globals ---------*/
+
+/*------ Receiver ------*/
+static protoFrame_t frame; // Filled by the RX ISR, then owned by the main loop until the reply
+static volatile uint8_t frame_ready = 0;
+static protoRxState_t rx_state = RX_IDLE;
+static uint8_t rx_pos;
+static uint8_t rx_drop; // Frame arrived while the last one is still being handled
+static uint16_t rx_crc; // Computed so far
+static uint16_t rx_crc_frame; // Sent in the frame
+static volatile uint8_t rx_idle = 0; // proto_tick() calls since the last byte
+
+static volatile uint16_t crc_errors = 0;
+static volatile uint16_t dropped = 0;
+
+/*------ Last reply, sent again for a repeated seq ------*/
+static uint8_t last_reply[PROTO_REPLY_MAX];
+static uint8_t last_len = 0; // 0 before the first reply
+static uint8_t last_seq;
+
+/*--------- Function definition ---------*/
+/**
+   End of a frame in the RX ISR, hand it to the main loop.
+*/
+static void rx_done(uint8_t err)
+{
+    if(err) {
+        ++crc_errors;
+    }
+    if(rx_drop) {
+        ++dropped;
+        return;
+    }
+    frame.err = err;
+    frame_ready = 1;
+}
+
+/**
+   Feed a received byte to the frame receiver, from the uart RX ISR.
+   Returns 0 if the byte is not part of a frame.
+*/
+uint8_t proto_rx(uint8_t c)
+{
+    rx_idle = 0;
+
+    switch(rx_state) {
+    case RX_IDLE:
+        if(c != PROTO_SOF) {
+            return 0;
+        }
+        rx_crc = 0xffff;
+        rx_drop = frame_ready;
+        rx_state = RX_SEQ;
+        break;
+    case RX_SEQ:
+        rx_crc = _crc_xmodem_update(rx_crc, c);
+        if(!rx_drop) {
+            frame.seq = c;
+        }
+        rx_state = RX_LEN;
+        break;
+    case RX_LEN:
+        rx_crc = _crc_xmodem_update(rx_crc, c);
+        if(!rx_drop) {
+            frame.len = c;
+        }
+        rx_pos = c; // Counts down
+        if(c > PROTO_MAX_LEN) {
+            rx_done(PROTO_ERR_LEN); // Worth a NAK, the seq may be right
+            rx_state = RX_SKIP; // Can not trust the length to skip the frame
+            break;
+        }
+        rx_state = c ? RX_DATA : RX_CRC0;
+        break;
+    case RX_DATA:
+        rx_crc = _crc_xmodem_update(rx_crc, c);
+        if(!rx_drop) {
+            frame.data[frame.len - rx_pos] = c;
+        }
+        if(--rx_pos == 0) {
+            rx_state = RX_CRC0;
+        }
+        break;
+    case RX_CRC0:
+        rx_crc_frame = c;
+        rx_state = RX_CRC1;
+        break;
+    case RX_CRC1:
+        rx_crc_frame |= (uint16_t)c << 8;
+        rx_state = RX_IDLE;
+        rx_done(rx_crc_frame != rx_crc ? PROTO_ERR_CRC : 0);
+        break;
+    case RX_SKIP:
+        break;
+    }
+    return 1;
+}
+
+/**
+   Whether a frame is being received, see proto_rx().
+*/
+uint8_t proto_receiving(void)
+{
+    return rx_state != RX_IDLE;
+}
+
+/**
+   Frame timeout, to be called periodically (Timer0 overflow).
+*/
+void proto_tick(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if(rx_idle < PROTO_TIMEOUT) {
+            ++rx_idle;
+        } else {
+            rx_state = RX_IDLE;
+        }
+    }
+}
+
+/**
+   Send a reply frame.
+*/
+static void send_frame(uint8_t seq, const uint8_t * data, uint8_t len)
+{
+    uint16_t crc = 0xffff;
+    crc = _crc_xmodem_update(crc, seq);
+    crc = _crc_xmodem_update(crc, len);
+    uart_send_char(PROTO_SOF);
+    uart_send_char(seq);
+    uart_send_char(len);
+    for(uint8_t i = 0; i < len; ++i) {
+        crc = _crc_xmodem_update(crc, data[i]);
+        uart_send_char(data[i]);
+    }
+    uart_send_char(crc & 0xff);
+    uart_send_char(crc >> 8);
+}
+
+/**
+   The frame received, to be run by the main loop and answered with
+   proto_reply(). NULL if there is none, or if it was a repeat (answered
+   here) or there is no room to send a reply yet.
+*/
+const protoFrame_t * proto_frame(void)
+{
+    if(!frame_ready || uart_tx_free() < PROTO_REPLY_MAX + 5) {
+        return NULL;
+    }
+    if(last_len && !frame.err && frame.seq == last_seq) {
+        send_frame(last_seq, last_reply, last_len);
+        frame_ready = 0;
+        return NULL;
+    }
+    return &frame;
+}
+
+/**
+   Decode the record at *pos into a command, advancing *pos. Returns 0 at
+   the end of the frame. A record cut short comes back as CMD_ERR_MISSING,
+   an unknown one as CMD_ERR_CMD.
+*/
+uint8_t proto_next(const protoFrame_t * f, uint8_t * pos, command_t * cmd)
+{
+    uint8_t p = *pos;
+    if(p >= f->len) {
+        return 0;
+    }
+    memset(cmd, 0, sizeof(*cmd));
+    cmd->cmd = f->data[p++];
+    uint8_t letters = 0; // Fields after the record type: a letter, if any,
+    uint8_t nums = 0;    // then 16 bit numbers
+    switch(cmd->cmd) {
+    case CMD_RUN:
+    case CMD_STOP:
+    case CMD_INTP:
+    case CMD_QUERY:
+    case CMD_TRIG:
+        break;
+    case CMD_CFG:
+        letters = 1;
+        nums = p < f->len && f->data[p] == WAVE_PULSE ? 2 : 1; // + duty
+        break;
+    case CMD_STRM:
+        nums = 1;
+        break;
+    case CMD_SWEEP:
+        letters = 1;
+        nums = 3;
+        break;
+    case CMD_AMPL:
+        nums = 2;
+        break;
+    case CMD_MOD:
+    case CMD_LIST:
+        letters = 1;
+        nums = 2; // Also for MOD_OFF and seqCtl_t, ignored
+        break;
+    default:
+        cmd->err = CMD_ERR_CMD;
+        cmd->bad = cmd->cmd;
+        break;
+    }
+    if(f->len - p < letters + 2*nums) {
+        cmd->err = CMD_ERR_MISSING;
+        *pos = f->len; // Nothing left to decode
+        return 1;
+    }
+    if(letters) {
+        cmd->letter = f->data[p++];
+        if(!cmd_letter_valid(cmd->cmd, cmd->letter)) {
+            cmd->err = CMD_ERR_LETTER;
+            cmd->bad = cmd->letter;
+        }
+    }
+    for(uint8_t i = 0; i < nums; ++i) {
+        cmd->num[i] = f->data[p] | (uint16_t)f->data[p + 1] << 8;
+        p += 2;
+    }
+    *pos = p;
+    return 1;
+}
+
+/**
+   Answer the frame from proto_frame() and release it. err is 0 (ACK), a
+   cmdErr_t or a protoErr_t, index the record it is about and st the state
+   to report for a query, NULL if there was none.
+*/
+void proto_reply(uint8_t err, uint8_t index, protoState_t * st)
+{
+    last_reply[0] = err ? PROTO_NAK : PROTO_ACK;
+    last_reply[1] = err;
+    last_reply[2] = index;
+    last_len = 3;
+    if(st) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            st->crc_errors = crc_errors;
+            st->dropped = dropped;
+        }
+        st->tx_dropped = uart_tx_dropped();
+        memcpy(last_reply + last_len, st, sizeof(*st));
+        last_len += sizeof(*st);
+    }
+    last_seq = frame.seq;
+    send_frame(last_seq, last_reply, last_len);
+    if(frame.err) {
+        last_len = 0; // Not a frame to match repeats against
+    }
+    frame_ready = 0;
+}
+
+/*--------- EOF ---------*/
@@ -0,0 +1,131 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   proto.h
+   @brief  Binary command protocol, for test rigs and other programs.
+
+   Mixed with the text commands and AWG frames on the same uart. A host
+   sends a frame and waits for the reply before sending the next one:
+
+       PROTO_SOF | seq | len | len bytes of records | crc (2 bytes)
+
+   seq is chosen by the host and echoed in the reply, len is up to
+   PROTO_MAX_LEN and crc is CRC-16/CCITT-FALSE (poly 0x1021, init 0xffff)
+   of seq, len and the records, little endian as every multi-byte field.
+   The records run in order, through the same dispatch as the text
+   commands:
+
+       'r'                        run
+       's'                        stop
+       'i'                        toggle interpolation
+       'c' wave freq (2 bytes)    configure, freq in Hz
+       'c' 'u' freq duty          pulse, 2 bytes each, see pulse.h
+       'x' rate (2 bytes)         start streaming, see stream.h
+       'w' law start stop ms      sweep, 2 bytes each number, see sweep.h
+       'a' amplitude offset       output level, 2 bytes each, 0-255
+       'm' mode a b               modulation, 2 bytes each number, see mod.h
+       't'                        trigger a burst
+       'l' wave freq periods      add a step to the list, see seq.h
+       'l' ctl 0 0                or play it, stop, clear (seqCtl_t)
+       '?'                        query, adds a protoState_t to the reply
+
+   The reply is a frame from the generator with the same layout, holding
+   PROTO_ACK or PROTO_NAK, an error (cmdErr_t or protoErr_t) and the index
+   of the record that failed; the records after a failed one do not run.
+   A frame with the seq of the last one is not run again, its reply is just
+   sent again, so a host that lost a reply can safely resend. Frames
+   arriving before the previous reply was sent are dropped (counted in
+   protoState_t), the host resends them after a timeout.
+
+   Other output (text replies, status line) only ever holds printable
+   characters, ESC and line breaks, so a host finds the replies by looking
+   for PROTO_SOF. The status line is not drawn after a frame, until the
+   next text command.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __PROTO_H__
+#define __PROTO_H__
+
+/*--- Includes ---*/
+
+#include <stdint.h>
+
+#include "cmd.h"
+
+/*--- Constants ---*/
+
+#define PROTO_SOF     (0x01) /*!< Start of frame (ASCII SOH), never in a text command */
+#define PROTO_ACK     (0x06)
+#define PROTO_NAK     (0x15)
+#define PROTO_MAX_LEN (32)   /*!< Record bytes per frame */
+#define PROTO_TIMEOUT (25)   /*!< proto_tick() calls without a byte before a frame is dropped */
+
+/*--------- Types ---------*/
+
+typedef enum protoErr {
+    PROTO_ERR_CRC = 0x80, /*!< Frame corrupted */
+    PROTO_ERR_LEN,        /*!< len over PROTO_MAX_LEN */
+} protoErr_t;
+
+typedef struct protoFrame {
+    uint8_t seq;
+    uint8_t len;
+    uint8_t err;   /*!< 0 or protoErr_t, the records are not valid if set */
+    uint8_t data[PROTO_MAX_LEN];
+} protoFrame_t;
+
+/*
+  Reply to a query, sent as is (the AVR is little endian and does not pad).
+*/
+typedef struct protoState {
+    uint8_t state;       /*!< 'r'un or 's'top */
+    uint8_t wave;        /*!< waveType_t */
+    uint8_t interp;      /*!< Interpolation on */
+    uint8_t flags;       /*!< PROTO_STREAMING, PROTO_SWEEPING, PROTO_LIST */
+    uint32_t freq;       /*!< mHz, the current one while sweeping or in FM */
+    uint16_t crc_errors; /*!< Frames with a bad crc or length */
+    uint16_t dropped;    /*!< Frames received before the last reply was sent */
+    uint8_t amplitude;   /*!< See dds_set_level() */
+    uint8_t offset;
+    uint8_t mod;         /*!< modType_t */
+    uint8_t idle;        /*!< % of the time the main loop slept, since the last query (event.h) */
+    uint16_t latency;    /*!< Longest ISR to main loop wait since the last query, us */
+    uint16_t tx_dropped; /*!< Uart characters and flash strings dropped, UART_TX_DROP (uart.h) */
+} protoState_t;
+
+#define PROTO_STREAMING (1 << 0)
+#define PROTO_SWEEPING  (1 << 1)
+#define PROTO_LIST      (1 << 2) /*!< A list plays or has played, see seq.h */
+
+#define PROTO_REPLY_MAX (3 + sizeof(protoState_t)) /*!< Reply record bytes */
+
+/*--------- Prototype dec ---------*/
+
+uint8_t proto_rx(uint8_t c);
+uint8_t proto_receiving(void);
+void proto_tick(void);
+const protoFrame_t * proto_frame(void);
+uint8_t proto_next(const protoFrame_t * frame, uint8_t * pos, command_t * cmd);
+void proto_reply(uint8_t err, uint8_t index, protoState_t * st);
+
+#endif /* __PROTO_H__ */
+
+/*--------- EOF ---------*/
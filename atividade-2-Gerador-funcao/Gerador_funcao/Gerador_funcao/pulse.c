@@ -0,0 +1,194 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   pulse.c
+   @brief  Hardware pulse output, see pulse.h.
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include <stdint.h>
+
+#include "util.h"
+
+#include "pulse.h"
+
+/*--------- Constants ---------*/
+
+#ifndef F_CPU
+#define F_CPU 8000000UL
+#endif
+
+#define PULSE_PIN PORTB,2 /* OC1B */
+
+#define TCCR1A_PWM (_BV(WGM11) | _BV(WGM10)) /* Fast PWM, TOP = OCR1A... */
+#define TCCR1B_PWM (_BV(WGM13) | _BV(WGM12)) /* ...mode 15, clock select below */
+#define PRESCALERS (5)
+
+/*--------- Globals ---------*/
+
+/* Timer1 prescalers, clock select bits and log2 of the division */
+static const uint8_t presc_cs[PRESCALERS] = { 1, 2, 3, 4, 5 };
+static const uint8_t presc_log2[PRESCALERS] = { 0, 3, 6, 8, 10 };
+
+static uint8_t cs = 1;        // Clock select for the pulse
+static uint16_t top = 0xffff; // OCR1A, period - 1 in timer clocks
+static uint16_t high = 0;     // OCR1B, high time - 1
+static uint8_t duty = 50;     // %
+
+static uint8_t active = 0;    // Timer1 is ours
+static uint8_t output = 0;    // Pulse connected to the pin
+static uint8_t saved_tccr1b;  // The sample clock, given back by pulse_stop()
+static uint16_t saved_ocr1a;
+
+/*--------- Function definition ---------*/
+/**
+   Load Timer1 at once, restarting the period. OCR1A and OCR1B are double
+   buffered in fast PWM and only loaded at BOTTOM, so they are written once
+   in normal mode (straight to the registers) and once more in fast PWM
+   (to the buffers, or the stale buffers would be loaded at BOTTOM).
+*/
+static void timer1_load(uint8_t tccr1b, uint16_t ocr1a, uint16_t ocr1b)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t tccr1a = TCCR1A;
+        TCCR1B = 0; // Stopped, normal mode
+        TCCR1A = tccr1a & ~TCCR1A_PWM;
+        OCR1A = ocr1a;
+        OCR1B = ocr1b;
+        TCNT1 = 0;
+        TCCR1A = tccr1a;
+        OCR1A = ocr1a;
+        OCR1B = ocr1b;
+        TCCR1B = tccr1b;
+    }
+}
+
+/**
+   Set the pulse frequency (f_hz, 0 is taken as 1) and duty cycle (0 to
+   PULSE_MAX_DUTY %, 0 and 100 hold the output low or high). Returns the
+   frequency actually set, in mHz. Applied at once in pulse mode, or by
+   pulse_start().
+*/
+uint32_t pulse_set(uint16_t f_hz, uint8_t d)
+{
+    f_hz = f_hz ? f_hz : 1;
+    duty = d < PULSE_MAX_DUTY ? d : PULSE_MAX_DUTY;
+
+    // CPU clocks per period, then the fastest timer clock that fits them
+    uint32_t clocks = (F_CPU + f_hz/2)/f_hz;
+    uint8_t i = 0;
+    while(i < PRESCALERS - 1 &&
+          ((clocks + (1UL << presc_log2[i] >> 1)) >> presc_log2[i]) > 0x10000UL) {
+        ++i;
+    }
+    uint8_t new_cs = presc_cs[i];
+    uint32_t n = (clocks + (1UL << presc_log2[i] >> 1)) >> presc_log2[i];
+    uint32_t h = (n*duty + PULSE_MAX_DUTY/2)/PULSE_MAX_DUTY;
+    h = h ? h : 1; // Only reaches OC1B for 0 < duty < 100
+    h = h < n ? h : n - 1;
+    top = n - 1;
+    high = h - 1;
+
+    if(active) {
+        if(new_cs == cs) {
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                OCR1A = top; // Double buffered, at the end of this period
+                OCR1B = high;
+            }
+        } else {
+            timer1_load(TCCR1B_PWM | new_cs, top, high);
+        }
+        pulse_output(output); // 0 or 100 % may have changed
+    }
+    cs = new_cs;
+
+    // (F_CPU >> log2)/n in mHz, in two steps to stay in 32 bits
+    uint32_t fc = F_CPU >> presc_log2[i];
+    return (fc/n)*1000UL + ((fc % n)*1000UL + n/2)/n;
+}
+
+/**
+   Take Timer1 over from the sample clock, the sample ISR stops. The output
+   stays off until pulse_output().
+*/
+void pulse_start(void)
+{
+    if(active) {
+        return;
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        TIMSK1 = 0x00;
+        saved_tccr1b = TCCR1B;
+        saved_ocr1a = OCR1A;
+    }
+    active = 1;
+    pulse_output(0);
+    timer1_load(TCCR1B_PWM | cs, top, high);
+}
+
+/**
+   Give Timer1 back to the sample clock, as pulse_start() found it. The
+   sample ISR is left off, for the caller to start.
+*/
+void pulse_stop(void)
+{
+    if(!active) {
+        return;
+    }
+    pulse_output(0);
+    active = 0;
+    timer1_load(saved_tccr1b, saved_ocr1a, 0);
+}
+
+/**
+   Connect the pulse to OC1B, or hold the pin low. At 0 and 100 % the pin
+   is just held low or high.
+*/
+void pulse_output(uint8_t on)
+{
+    output = on;
+    uint8_t com = 0;
+    if(on && active && duty > 0 && duty < PULSE_MAX_DUTY) {
+        com = _BV(COM1B1); // Set at BOTTOM, cleared at OCR1B
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        TCCR1A = TCCR1A_PWM | com;
+        if(on && active && duty >= PULSE_MAX_DUTY) {
+            set_bit(PULSE_PIN);
+        } else {
+            rst_bit(PULSE_PIN);
+        }
+    }
+}
+
+/**
+   Whether Timer1 is making the pulse (pulse_start()).
+*/
+uint8_t pulse_active(void)
+{
+    return active;
+}
+
+/*--------- EOF ---------*/
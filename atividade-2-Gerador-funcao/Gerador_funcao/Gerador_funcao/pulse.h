@@ -0,0 +1,65 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   pulse.h
+   @brief  Hardware pulse output (WAVE_PULSE), Timer1 fast PWM on OC1B.
+
+   The square wave played by the DDS costs a sample ISR per sample and is
+   limited to MAX_F. In pulse mode Timer1 stops being the sample clock and
+   makes the pulse itself: fast PWM with TOP = OCR1A (the period) and OC1B
+   cleared at OCR1B (the duty cycle), so the CPU does nothing per edge and
+   the edges are exact to the clock cycle. The timer clock is the fastest
+   prescaler that fits the period in 16 bits: 1 Hz to 65535 Hz, with the
+   duty cycle good to 1% all the way up.
+
+   OC1B is PB2, bit 2 of the DAC port: the pulse is a logic level signal
+   taken from that pin, the DAC output only moves by 4 LSB with it. The
+   rest of the DAC port holds while the sample ISR is off. With the SPI DAC
+   (see dac.h) PB2 is the unused SS pin, and the DAC is left alone.
+
+   pulse_start() borrows Timer1 and pulse_stop() gives it back to the
+   sample clock as it was. Frequency and duty cycle changes while running
+   take effect at the end of the current period, unless the prescaler has
+   to change.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __PULSE_H__
+#define __PULSE_H__
+
+/*--- Includes ---*/
+
+#include <stdint.h>
+
+/*--- Constants ---*/
+
+#define PULSE_MAX_DUTY (100) /*!< % */
+
+/*--------- Prototype dec ---------*/
+
+uint32_t pulse_set(uint16_t f_hz, uint8_t duty);
+void pulse_start(void);
+void pulse_stop(void);
+void pulse_output(uint8_t on);
+uint8_t pulse_active(void);
+
+#endif /* __PULSE_H__ */
+
+/*--------- EOF ---------*/
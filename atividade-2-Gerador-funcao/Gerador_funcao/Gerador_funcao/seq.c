@@ -0,0 +1,177 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   seq.c
+   @brief  Waveform sequencer (list mode), see seq.h.
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dds.h"
+
+#include "seq.h"
+
+/*--------- Globals ---------*/
+/*
+  The list is only changed by seq_add() and seq_clear(), the rest is
+  shared between the main loop and seq_tick().
+*/
+static seqStep_t steps[SEQ_LEN];
+static volatile uint8_t len = 0;
+
+static volatile uint8_t active = 0;  // Owns the output, playing or done
+static volatile uint8_t playing = 0; // Steps left to queue
+static uint8_t loop;
+static volatile uint8_t cur;         // Step playing
+static volatile uint8_t queued = 0;  // Step cur + 1 queued in the DDS
+static volatile uint8_t ended = 0;   // For seq_ended()
+static volatile uint16_t late = 0;   // Steps started late
+
+/*--------- Function definition ---------*/
+/**
+   Append a step, f_hz up to Nyquist. Returns 0 if the list is full or the
+   step is shorter than SEQ_MIN_MS.
+*/
+uint8_t seq_add(waveType_t wave, uint16_t f_hz, uint16_t periods)
+{
+    if(len >= SEQ_LEN || !periods || !f_hz ||
+       (uint32_t)periods*1000 < (uint32_t)SEQ_MIN_MS*f_hz) {
+        return 0;
+    }
+    seqStep_t * s = &steps[len];
+    s->wave = wave;
+    s->tuning = dds_freq_to_tuning(f_hz*1000UL) >> 8;
+    s->periods = periods;
+    ++len; // Only now seq_tick() may see it
+    return 1;
+}
+
+void seq_clear(void)
+{
+    seq_stop();
+    len = 0;
+}
+
+/**
+   Play the list from its first step, once or in a loop. Returns 0 if it
+   is empty.
+*/
+uint8_t seq_start(uint8_t l)
+{
+    seq_stop();
+    if(!len) {
+        return 0;
+    }
+    loop = l;
+    cur = 0;
+    queued = 0;
+    late = 0;
+    ended = 0;
+    dds_set_burst(1); // Rest between and after the steps
+    dds_step(steps[0].wave, steps[0].tuning, steps[0].periods); // Nothing playing, starts now
+    active = 1;
+    playing = 1;
+    return 1;
+}
+
+/**
+   Stop playing and leave burst mode, the wave and frequency are left as
+   the last step had them for the caller to set.
+*/
+void seq_stop(void)
+{
+    if(!active) {
+        return;
+    }
+    playing = 0;
+    active = 0;
+    dds_set_burst(0);
+}
+
+uint8_t seq_active(void)
+{
+    return active;
+}
+
+/**
+   Step playing, NULL if no list is.
+*/
+const seqStep_t * seq_playing(void)
+{
+    return playing ? &steps[cur] : NULL;
+}
+
+/**
+   Whether a one shot list finished since the last call, and how many steps
+   started late.
+*/
+uint8_t seq_ended(uint16_t * l)
+{
+    uint8_t r;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        r = ended;
+        ended = 0;
+        *l = late;
+    }
+    return r;
+}
+
+/**
+   Keep the next step queued, to be called on every Timer0 overflow.
+*/
+void seq_tick(void)
+{
+    if(!playing) {
+        return;
+    }
+    if(queued) {
+        if(dds_step_pending()) {
+            return; // The step playing is not over yet
+        }
+        queued = 0;
+        cur = cur + 1 < len ? cur + 1 : 0;
+    }
+    uint8_t next = cur + 1;
+    if(next >= len) {
+        if(!loop) {
+            if(!dds_burst_playing()) {
+                playing = 0; // The last step is over, resting
+                ended = 1;
+            }
+            return;
+        }
+        next = 0;
+    }
+    if(dds_step(steps[next].wave, steps[next].tuning, steps[next].periods) == DDS_STEP_NOW) {
+        ++late; // cur was over before this tick
+        cur = next;
+    } else {
+        queued = 1;
+    }
+}
+
+/*--------- EOF ---------*/
@@ -0,0 +1,83 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   seq.h
+   @brief  Waveform sequencer (list mode).
+
+   A list of up to SEQ_LEN steps, each a wave, a frequency and a number of
+   whole periods, played one after the other, once or over and over. The
+   timing is kept by the sample clock: the periods of a step are counted
+   in the sample ISR, which starts the next step at the period boundary
+   where they run out (see dds_step() and dds_isr.s), so the steps are
+   exactly as long as asked, whatever the main loop is doing.
+
+   seq_tick(), on every Timer0 overflow (8.2 ms), queues the step after the
+   one playing. Steps must then last at least SEQ_MIN_MS, or the next one
+   may not be queued in time: it would then start late, at the next tick,
+   after resting at the offset meanwhile (counted, see seq_ended()).
+
+   A finished one shot list rests at the offset until seq_stop(). While a
+   list plays, it owns the wave and the frequency.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __SEQ_H__
+#define __SEQ_H__
+
+/*--- Includes ---*/
+
+#include <stdint.h>
+
+#include "dds.h"
+
+/*--- Constants ---*/
+
+#define SEQ_LEN    (16) /*!< Steps in the list */
+#define SEQ_MIN_MS (17) /*!< Shortest step, two Timer0 ticks */
+
+/*--------- Types ---------*/
+
+typedef enum seqCtl {
+    SEQ_ONCE  = 'o', /*!< Play the list once */
+    SEQ_LOOP  = 'l', /*!< Play the list over and over */
+    SEQ_END   = 'e', /*!< Stop playing */
+    SEQ_CLEAR = 'd'  /*!< Stop and delete the steps */
+} seqCtl_t;
+
+typedef struct seqStep {
+    waveType_t wave;
+    phase_t tuning;   /*!< See dds_set_freq() */
+    uint16_t periods;
+} seqStep_t;
+
+/*--------- Prototype dec ---------*/
+
+uint8_t seq_add(waveType_t wave, uint16_t f_hz, uint16_t periods);
+void seq_clear(void);
+uint8_t seq_start(uint8_t loop);
+void seq_stop(void);
+uint8_t seq_active(void);
+const seqStep_t * seq_playing(void);
+uint8_t seq_ended(uint16_t * late);
+void seq_tick(void);
+
+#endif /* __SEQ_H__ */
+
+/*--------- EOF ---------*/
@@ -0,0 +1,209 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   status.c
+   @brief  Serial console status line, see status.h.
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/pgmspace.h>
+
+#include <stdint.h>
+
+#include "uart.h"
+
+#include "status.h"
+
+/*--------- Constants ---------*/
+/*
+  Field columns of the line, as drawn by status_show():
+  "status: r  wave: s  freq:  1234.567 Hz  cmd: "
+*/
+#define COL_STATE (8)
+#define COL_WAVE  (17)
+#define COL_FREQ  (26)
+#define COL_CMD   (45)
+#define OUT_LEN   (COL_CMD + STATUS_CMD_LEN + 32) /*!< Longest update, with escapes */
+
+/*--------- Globals ---------*/
+
+static uint8_t shown = 0; // Line is on the terminal, as in last and last_cmd
+static genStatus_t last;
+static char last_cmd[STATUS_CMD_LEN + 1];
+
+/*--------- Function definition ---------*/
+
+static char * put_str(char * p, const char * s)
+{
+    while(*s) {
+        *p++ = *s++;
+    }
+    return p;
+}
+
+static char * put_str_P(char * p, PGM_P s)
+{
+    char c;
+    while((c = pgm_read_byte(s++))) {
+        *p++ = c;
+    }
+    return p;
+}
+
+/**
+   v in decimal, right aligned to width with pad.
+*/
+static char * put_dec(char * p, uint16_t v, uint8_t width, char pad)
+{
+    char digits[5];
+    uint8_t n = 0;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while(v);
+    for(; width > n; --width) {
+        *p++ = pad;
+    }
+    while(n) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+/**
+   Frequency in mHz as " 1234.567", always 9 characters up to the 65535 Hz
+   of the pulse mode (see pulse.h).
+*/
+static char * put_freq(char * p, uint32_t f)
+{
+    p = put_dec(p, f / 1000, 5, ' ');
+    *p++ = '.';
+    return put_dec(p, f % 1000, 3, '0');
+}
+
+/**
+   Cursor to col of the status line: carriage return, then ESC [ col C.
+*/
+static char * put_move(char * p, uint8_t col)
+{
+    *p++ = '\r';
+    if(col) {
+        *p++ = 0x1b;
+        *p++ = '[';
+        p = put_dec(p, col, 0, 0);
+        *p++ = 'C';
+    }
+    return p;
+}
+
+/**
+   Draw the status line, or only what changed since the last time. Returns
+   0 if the transmit ring has no room for it yet; nothing is sent then and
+   the caller should try again later.
+*/
+uint8_t status_show(const genStatus_t * st)
+{
+    char out[OUT_LEN];
+    char * p = out;
+    char cmd[STATUS_CMD_LEN + 1];
+    uint8_t n, i;
+
+    // Take a copy, the RX ISR may be writing to it
+    for(n = 0; n < STATUS_CMD_LEN && st->cmd[n] && st->cmd[n] != '\r'; ++n) {
+        cmd[n] = st->cmd[n];
+    }
+    cmd[n] = 0;
+
+    if(!shown) {
+        p = put_str_P(p, PSTR("\rstatus: "));
+        *p++ = st->state;
+        p = put_str_P(p, PSTR("  wave: "));
+        *p++ = st->wave;
+        p = put_str_P(p, PSTR("  freq: "));
+        p = put_freq(p, st->freq);
+        p = put_str_P(p, PSTR(" Hz  cmd: "));
+        p = put_str(p, cmd);
+        p = put_str_P(p, PSTR("\x1b[K"));
+    } else {
+        if(st->state != last.state) {
+            p = put_move(p, COL_STATE);
+            *p++ = st->state;
+        }
+        if(st->wave != last.wave) {
+            p = put_move(p, COL_WAVE);
+            *p++ = st->wave;
+        }
+        if(st->freq != last.freq) {
+            p = put_move(p, COL_FREQ);
+            p = put_freq(p, st->freq);
+        }
+        // Only from the first character that differs
+        for(i = 0; cmd[i] && cmd[i] == last_cmd[i]; ++i);
+        if(cmd[i] != last_cmd[i]) {
+            p = put_move(p, COL_CMD + i);
+            p = put_str(p, cmd + i);
+            p = put_str_P(p, PSTR("\x1b[K")); // In case it got shorter
+        } else if(p != out) {
+            p = put_move(p, COL_CMD + n); // Cursor back after the command
+        }
+        if(p == out) {
+            return 1; // Nothing changed, nothing to send
+        }
+    }
+    *p = 0;
+
+    if(uart_tx_free() < p - out) {
+        return 0;
+    }
+    uart_send_str(out);
+
+    last = *st;
+    for(i = 0; i <= n; ++i) {
+        last_cmd[i] = cmd[i];
+    }
+    shown = 1;
+    return 1;
+}
+
+/**
+   v in decimal and NUL terminated into buff (6 chars), for the other text
+   output, which then needs no printf.
+*/
+char * status_dec(char * buff, uint16_t v)
+{
+    *put_dec(buff, v, 0, 0) = '\0';
+    return buff;
+}
+
+/**
+   Erase the status line, so other text can be printed. It is drawn again in
+   full by the next status_show().
+*/
+void status_hide(void)
+{
+    if(shown) {
+        uart_send_str("\r\x1b[K"); // From RAM, only one flash string can be pending
+        shown = 0;
+    }
+}
+
+/*--------- EOF ---------*/
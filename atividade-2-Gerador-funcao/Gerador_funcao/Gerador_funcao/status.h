@@ -0,0 +1,65 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   status.h
+   @brief  Serial console status line, redrawn only where it changed.
+
+   The status is a single line at the bottom of the terminal:
+
+       status: r  wave: s  freq:   10.000 Hz  cmd: c s 100
+
+   The last drawn values are kept, so a refresh only sends the fields that
+   changed, each with a carriage return and an ANSI cursor forward
+   (ESC [ n C) to its column, and nothing at all if nothing changed. Typing
+   a command sends just the new characters. Other output must call
+   status_hide() first, which erases the line (ESC [ K); the next
+   status_show() draws it again in full.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __STATUS_H__
+#define __STATUS_H__
+
+/*--- Includes ---*/
+
+#include <stdint.h>
+
+/*--- Constants ---*/
+
+#define STATUS_CMD_LEN (32) /*!< Command characters shown, the rest is cut */
+
+/*--------- Types ---------*/
+
+typedef struct genStatus {
+    char state;        /*!< 'r'un or 's'top */
+    char wave;         /*!< waveType_t */
+    uint32_t freq;     /*!< mHz */
+    const char * cmd;  /*!< Command being typed, up to '\r' or '\0' */
+} genStatus_t;
+
+/*--------- Prototype dec ---------*/
+
+uint8_t status_show(const genStatus_t * st);
+void status_hide(void);
+char * status_dec(char * buff, uint16_t v);
+
+#endif /* __STATUS_H__ */
+
+/*--------- EOF ---------*/
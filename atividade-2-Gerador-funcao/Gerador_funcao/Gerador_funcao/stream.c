@@ -0,0 +1,157 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   stream.c
+   @brief  Sample streaming from the uart, see stream.h.
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include <stdint.h>
+
+#include "stream.h"
+
+#if STREAM_LEN != 256
+#error "The ring indexes are uint8_t, STREAM_LEN must be 256"
+#endif
+
+#if STREAM_BUF_ADDR != RAMSTART
+#error "The ring is placed at the start of the RAM, see -Wl,-Tdata in the project"
+#endif
+
+/*--------- Globals ---------*/
+/*
+  Shared with the sample ISR in dds_isr.s, hence not static. The uart RX ISR
+  only moves the head and the sample ISR only the tail.
+*/
+volatile uint8_t stream_buf[STREAM_LEN] __attribute__((address(STREAM_BUF_ADDR))); // Also the fast mode table, see fast.h
+volatile uint8_t stream_head = 0; // Next free slot
+volatile uint8_t stream_tail = 0; // Next sample to play
+volatile uint16_t stream_underruns = 0;
+volatile uint8_t stream_starved = 1; // Ring is dry and already counted
+
+static volatile uint8_t active = 0;
+static volatile uint8_t ended = 0;
+static volatile uint8_t idle = 0; // stream_tick() calls since the last byte
+static volatile uint16_t overruns = 0;
+static uint8_t xoff_sent = 0;
+
+/*--------- Function definition ---------*/
+/**
+   Empty the ring and take every byte received from now on as a sample.
+*/
+void stream_start(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        stream_head = 0;
+        stream_tail = 0;
+        stream_underruns = 0;
+        stream_starved = 1; // Empty before the first sample is no underrun
+        overruns = 0;
+        idle = 0;
+        ended = 0;
+        active = 1;
+    }
+    xoff_sent = 1; // So the first stream_flow() gives the host an XON
+}
+
+uint8_t stream_active(void)
+{
+    return active;
+}
+
+/**
+   Feed a received byte, from the uart RX ISR. Returns 0 if not streaming.
+*/
+uint8_t stream_rx(uint8_t c)
+{
+    if(!active) {
+        return 0;
+    }
+    idle = 0;
+
+    uint8_t next = stream_head + 1; // Wraps at STREAM_LEN
+    if(next == stream_tail) {
+        ++overruns; // Full, the host ignored XOFF
+    } else {
+        stream_buf[stream_head] = c;
+        stream_head = next;
+    }
+    return 1;
+}
+
+/**
+   End of stream timeout, to be called periodically (Timer0 overflow).
+*/
+void stream_tick(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if(active) {
+            if(idle < STREAM_TIMEOUT) {
+                ++idle;
+            } else {
+                active = 0;
+                ended = 1;
+            }
+        }
+    }
+}
+
+/**
+   Flow control byte to send the host (XON or XOFF), 0 for none. Call it
+   from the main loop, the sooner after a byte is received the better.
+*/
+uint8_t stream_flow(void)
+{
+    if(!active) {
+        return 0;
+    }
+    uint8_t queued = stream_head - stream_tail;
+    if(!xoff_sent && queued >= STREAM_HIGH) {
+        xoff_sent = 1;
+        return XOFF;
+    }
+    if(xoff_sent && queued <= STREAM_LOW) {
+        xoff_sent = 0;
+        return XON;
+    }
+    return 0;
+}
+
+/**
+   Whether the stream has ended since the last call, with its counters.
+*/
+uint8_t stream_ended(streamStats_t * stats)
+{
+    uint8_t r;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        r = ended;
+        ended = 0;
+        stats->underruns = stream_underruns;
+        stats->overruns = overruns;
+    }
+    return r;
+}
+
+/*--------- EOF ---------*/
@@ -0,0 +1,79 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   stream.h
+   @brief  Sample streaming from the uart, the board as a streaming DAC.
+
+   In stream mode (WAVE_STREAM) every byte received is a sample. The uart RX
+   ISR puts them in a ring buffer and the sample ISR takes one out at the
+   start of every DDS period, so the stream sample rate is the configured
+   frequency. If the ring is empty the last sample is held (underrun), if
+   it is full the byte is lost (overrun); both are counted.
+
+   Flow control is XON/XOFF: XOFF is sent when the ring fills up to
+   STREAM_HIGH samples and XON once it drains down to STREAM_LOW. Stream
+   mode ends, back to text commands, when the line is quiet for
+   STREAM_TIMEOUT ticks, and the main loop goes back to the wave played
+   before it.
+
+   The ring is also the fast mode table, which must start at a 256 byte
+   boundary (see fast.h). It sits at the start of the RAM, at a fixed
+   address (STREAM_BUF_ADDR), and the linker starts .data right after it
+   (-Wl,-Tdata in the project), so the alignment wastes no RAM.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+/*--- Includes ---*/
+
+#include <stdint.h>
+
+/*--- Constants ---*/
+
+#define STREAM_LEN  (256) /*!< Ring size, the 8 bit indexes wrap by themselves */
+#define STREAM_HIGH (128) /*!< Send XOFF from this many samples queued */
+#define STREAM_LOW  (64)  /*!< Send XON again from this many samples queued */
+#define STREAM_TIMEOUT (60) /*!< stream_tick() calls without a byte to end the stream */
+#define STREAM_BUF_ADDR (0x100) /*!< The ring, RAMSTART, .data starts at + STREAM_LEN */
+
+#define XON  (0x11)
+#define XOFF (0x13)
+
+/*--------- Types ---------*/
+
+typedef struct streamStats {
+    uint16_t underruns; /*!< Times the ring ran dry */
+    uint16_t overruns;  /*!< Samples lost to a full ring */
+} streamStats_t;
+
+/*--------- Prototype dec ---------*/
+
+void stream_start(void);
+uint8_t stream_active(void);
+uint8_t stream_rx(uint8_t c);
+void stream_tick(void);
+uint8_t stream_flow(void);
+uint8_t stream_ended(streamStats_t * stats);
+
+#endif /* __STREAM_H__ */
+
+/*--------- EOF ---------*/
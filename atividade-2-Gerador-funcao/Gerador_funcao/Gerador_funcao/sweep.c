@@ -0,0 +1,154 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   sweep.c
+   @brief  Frequency sweep (chirp), see sweep.h.
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include <math.h>
+#include <stdint.h>
+
+#include "dds.h"
+
+#include "sweep.h"
+
+#ifndef F_CPU
+#define F_CPU 8000000UL
+#endif
+
+/*
+  Samples per tick, as a multiply: slope = delta*SAMPLE_CYCLES/2^16 spreads
+  a tuning change over the SWEEP_TICK_CYCLES/SAMPLE_CYCLES samples (163.84)
+  of a tick.
+*/
+#define SAMPLE_CYCLES (F_CPU/SAMPLE_RATE)
+
+#if SWEEP_TICK_CYCLES != 65536UL || F_CPU % SAMPLE_RATE
+#error "sweep_tick() assumes 2^16 cycle ticks and a whole number of cycles per sample"
+#endif
+
+/*--------- Globals ---------*/
+/*
+  Set up by sweep_start() with the sweep off, then only used by sweep_tick().
+*/
+static volatile uint8_t active = 0;
+static sweepLaw_t law;
+static uint32_t start, stop; // Tuning words, 24.8
+static uint16_t ticks;       // Sweep length
+static uint16_t tick;        // Ticks since the start of the sweep
+static int32_t step;         // Linear: tuning change per tick, 24.8
+static uint32_t ratio;       // Logarithmic: tuning ratio per tick, 2.30
+static uint32_t target;      // Tuning word at the next tick, 24.8
+
+/*--------- Function definition ---------*/
+/**
+   Sweep from f0 to f1 (mHz, up to DDS_MAX_MHZ) in t_ms milliseconds, over
+   and over. Returns 0 if the sweep can not be done: a frequency of 0 in a
+   logarithmic one, or more than 2 octaves per tick.
+*/
+uint8_t sweep_start(sweepLaw_t l, uint32_t f0_mhz, uint32_t f1_mhz, uint16_t t_ms)
+{
+    sweep_stop();
+
+    start = dds_freq_to_tuning(f0_mhz);
+    stop = dds_freq_to_tuning(f1_mhz);
+    ticks = ((uint32_t)t_ms*(F_CPU/1000)) >> 16;
+    ticks = ticks ? ticks : 1;
+    law = l;
+
+    if(law == SWEEP_LOG) {
+        if(!start || !stop) {
+            return 0;
+        }
+        // Once per sweep, the float math is fine here
+        double r = exp(log((double)stop/start)/ticks);
+        if(r >= 4.0) {
+            return 0;
+        }
+        ratio = r*(1UL << 30) + 0.5;
+    } else {
+        step = ((int32_t)stop - (int32_t)start)/ticks;
+    }
+
+    tick = ticks; // The first tick starts the sweep
+    target = stop;
+    dds_set_tuning(start);
+    active = 1;
+    return 1;
+}
+
+void sweep_stop(void)
+{
+    active = 0;
+    dds_set_slope(0, dds_get_tuning());
+}
+
+uint8_t sweep_active(void)
+{
+    return active;
+}
+
+/**
+   Advance the sweep, to be called on every Timer0 overflow. Sets the slope
+   that takes the tuning word to where the sweep law wants it at the next
+   tick, from where it is now.
+*/
+void sweep_tick(void)
+{
+    if(!active) {
+        return;
+    }
+    if(tick >= ticks) {
+        // At the stop frequency, back to the start one
+        tick = 0;
+        target = start;
+        dds_set_tuning(start);
+    }
+    ++tick;
+    if(tick == ticks) {
+        target = stop; // Land exactly, whatever the rounding on the way
+    } else if(law == SWEEP_LOG) {
+        target = ((uint64_t)target*ratio) >> 30;
+    } else {
+        target += step;
+    }
+    sweep_ramp(target);
+}
+
+/**
+   Set the slope that takes the tuning word from where it is now to the
+   one given (24.8 fixed point) at the next tick. Also used by FM (see mod.h).
+*/
+void sweep_ramp(uint32_t to)
+{
+    uint32_t now = dds_get_tuning();
+    int32_t delta = to - now;
+    int32_t slope = (delta >> 16)*SAMPLE_CYCLES +
+        (int32_t)(((delta & 0xffff)*SAMPLE_CYCLES) >> 16);
+    dds_set_slope(slope, to > now ? to : now);
+}
+
+/*--------- EOF ---------*/
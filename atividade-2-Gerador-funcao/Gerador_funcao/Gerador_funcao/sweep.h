@@ -0,0 +1,68 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   sweep.h
+   @brief  Frequency sweep (chirp), linear or logarithmic.
+
+   The sweep runs in the sample path: while it is on, the sample ISR adds a
+   slope to the tuning word every sample (24.8 fixed point, see dds_isr.s),
+   so the frequency ramps smoothly and the phase stays continuous. The
+   schedule is kept by sweep_tick(), called on every Timer0 overflow
+   (SWEEP_TICK_CYCLES): it works out where the tuning word must be at the
+   next tick, following the sweep law, and sets the slope that gets it
+   there from where it actually is. Errors do not add up and the main loop
+   and the uart can take as long as they like.
+
+   A logarithmic sweep is a chain of short linear ramps, one per tick, each
+   a constant ratio above the last (8.2 ms segments, invisible on a scope).
+   At the stop frequency the sweep jumps back to the start one and repeats
+   until sweep_stop().
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __SWEEP_H__
+#define __SWEEP_H__
+
+/*--- Includes ---*/
+
+#include <stdint.h>
+
+/*--- Constants ---*/
+
+#define SWEEP_TICK_CYCLES (65536UL) /*!< Between sweep_tick() calls, Timer0 at prescaler 256 */
+
+/*--------- Types ---------*/
+
+typedef enum sweepLaw {
+    SWEEP_LIN = 'l', /*!< Constant Hz/s */
+    SWEEP_LOG = 'g'  /*!< Constant octaves/s */
+} sweepLaw_t;
+
+/*--------- Prototype dec ---------*/
+
+uint8_t sweep_start(sweepLaw_t law, uint32_t f0_mhz, uint32_t f1_mhz, uint16_t t_ms);
+void sweep_stop(void);
+uint8_t sweep_active(void);
+void sweep_tick(void);
+void sweep_ramp(uint32_t to);
+
+#endif /* __SWEEP_H__ */
+
+/*--------- EOF ---------*/
@@ -0,0 +1,200 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   uart.c
+   @brief  Interrupt driven uart transmitter, see uart.h.
+   ----------------------------------------------------------------------------
+*/
+
+/*--------- Includes ---------*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "uart.h"
+
+#ifndef F_CPU
+#define F_CPU 8000000UL
+#endif
+
+#if UART_TX_LEN != 256
+#error "The ring indexes are uint8_t, UART_TX_LEN must be 256"
+#endif
+
+/*--------- Globals ---------*/
+
+static volatile char tx_buff[UART_TX_LEN];
+static volatile uint8_t tx_head = 0; // Next free slot
+static volatile uint8_t tx_tail = 0; // Next char to send
+static volatile char tx_ctrl = 0; // Sent before anything else, 0 for none
+static PGM_P volatile tx_pgm = NULL; // Flash string being sent
+static volatile uint8_t tx_pgm_at; // ... once the ring tail gets here
+static volatile uint16_t tx_dropped = 0;
+
+/*--------- Interrupts ---------*/
+
+/**
+   Send the next character. Unlike the other ISRs this one can not re-enable
+   interrupts early: UDRE0 is level triggered and would fire again at once.
+   It is short, so the delay it adds to the sample ISR is small.
+*/
+ISR(USART_UDRE_vect)
+{
+    char c = tx_ctrl;
+
+    if(c) {
+        tx_ctrl = 0;
+        UDR0 = c;
+        return;
+    }
+    if(tx_pgm && tx_tail == tx_pgm_at) {
+        c = pgm_read_byte(tx_pgm);
+        if(c) {
+            ++tx_pgm;
+            UDR0 = c;
+            return;
+        }
+        tx_pgm = NULL; // Done, back to the ring
+    }
+    if(tx_tail != tx_head) {
+        UDR0 = tx_buff[tx_tail];
+        ++tx_tail; // Wraps at UART_TX_LEN
+    } else {
+        UCSR0B &= ~(1 << UDRIE0); // Nothing left, stop until the next char
+    }
+}
+
+/*--------- Function definition ---------*/
+
+static inline void tx_kick(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        UCSR0B |= (1 << UDRIE0);
+    }
+}
+
+void uart_init(uint32_t baudrate)
+{
+    // Configure uart
+    UCSR0B = (1 << TXEN0)|(1 << RXEN0); // Enable serial RX and TX
+    UCSR0B |= (1 << RXCIE0); // Enable serial reception on interruption
+    UCSR0C = (1 << UCSZ00) | (1 << UCSZ01); // 8bits per frame
+    UBRR0H = (((F_CPU / ((uint32_t)16 * baudrate) ) - 1) >> 8);
+    UBRR0L = ((F_CPU / ((uint32_t)16 * baudrate) ) - 1); // Modo Normal Assíncrono;
+}
+
+/**
+   Queue a character. Returns 0 if it was dropped (UART_TX_DROP, ring full).
+*/
+uint8_t uart_send_char(const char c)
+{
+    uint8_t next = tx_head + 1; // Wraps at UART_TX_LEN
+
+    if(next == tx_tail) {
+#if UART_TX_POLICY == UART_TX_BLOCK
+        while(next == tx_tail); // Wait for the ISR to make room
+#else
+        ++tx_dropped;
+        return 0;
+#endif
+    }
+    tx_buff[tx_head] = c;
+    tx_head = next;
+    tx_kick();
+    return 1;
+}
+
+void uart_send_str(const char * buff)
+{
+    // Increment pointer until found null byte
+    for(;*buff;++buff)
+    {
+        uart_send_char(*buff);
+    }
+}
+
+/**
+   Queue a string in flash, sent in place after what is queued now. Only
+   one can be pending: with UART_TX_DROP a second one is dropped (returns
+   0), with UART_TX_BLOCK it waits for the first to be sent.
+*/
+uint8_t uart_send_str_P(PGM_P s)
+{
+    if(tx_pgm) {
+#if UART_TX_POLICY == UART_TX_BLOCK
+        while(tx_pgm);
+#else
+        ++tx_dropped;
+        return 0;
+#endif
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        tx_pgm_at = tx_head;
+        tx_pgm = s;
+    }
+    tx_kick();
+    return 1;
+}
+
+/**
+   Send a control character (XON/XOFF) ahead of everything queued. A
+   second one before the first is sent replaces it.
+*/
+void uart_send_ctrl(const char c)
+{
+    tx_ctrl = c;
+    tx_kick();
+}
+
+/**
+   Room left in the ring, to send a whole line or nothing.
+*/
+uint8_t uart_tx_free(void)
+{
+    return tx_tail - tx_head - 1;
+}
+
+/**
+   Wait until everything queued is handed to the uart, the last character
+   shifts out on its own. Needs interrupts on.
+*/
+void uart_flush(void)
+{
+    while(UCSR0B & (1 << UDRIE0));
+}
+
+/**
+   Characters (and flash strings) dropped so far.
+*/
+uint16_t uart_tx_dropped(void)
+{
+    uint16_t d;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        d = tx_dropped;
+    }
+    return d;
+}
+
+/*--------- EOF ---------*/
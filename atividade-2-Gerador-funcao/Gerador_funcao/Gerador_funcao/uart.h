@@ -0,0 +1,68 @@
+/**
+   ----------------------------------------------------------------------------
+   Copyright (c) 2020 Lucas Martins Mendes & Matheus Reibnitz  Willemann
+   All rights reserved.
+
+   Redistribution and use in source and binary forms are permitted
+   provided that the above copyright notice and this paragraph are
+   duplicated in all such forms and that any documentation,
+   advertising materials, and other materials related to such
+   distribution and use acknowledge that the software was developed
+   by Lucas M. M. & Matheus R. W..
+   The name of the Lucas Martins Mendes may not be used to endorse or
+   promote products derived from this software without specific
+   prior written permission.
+   THIS SOFTWARE IS PROVIDED ''AS IS'' AND WITHOUT ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED
+
+   WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+
+   @author Lucas Martins Mendes &  Matheus Reibnitz  Willemann
+   @file   uart.h
+   @brief  Interrupt driven uart transmitter.
+
+   Nothing sent waits for the line: characters go to a UART_TX_LEN ring
+   emptied by the data register empty (UDRE) interrupt. Flash strings
+   (uart_send_str_P()) are not copied, the ISR reads them in place after
+   whatever was queued before, so long texts do not need room in the ring.
+   A control character (uart_send_ctrl(), e.g. XON/XOFF) skips the queue.
+
+   When the ring is full UART_TX_POLICY decides: UART_TX_DROP throws the
+   character away (and counts it, see uart_tx_dropped(), reported in the
+   protoState_t of a query), UART_TX_BLOCK waits for room.
+   ----------------------------------------------------------------------------
+*/
+
+#ifndef __UART_H__
+#define __UART_H__
+
+/*--- Includes ---*/
+
+#include <avr/pgmspace.h>
+
+#include <stdint.h>
+
+/*--- Config ---*/
+
+#define UART_TX_DROP  0
+#define UART_TX_BLOCK 1
+#define UART_TX_POLICY UART_TX_DROP
+
+/*--- Constants ---*/
+
+#define UART_TX_LEN (256) /*!< Ring size, the 8 bit indexes wrap by themselves */
+
+/*--------- Prototype dec ---------*/
+
+void uart_init(uint32_t baudrate);
+uint8_t uart_send_char(const char c);
+void uart_send_str(const char * buff);
+uint8_t uart_send_str_P(PGM_P s);
+void uart_send_ctrl(const char c);
+uint8_t uart_tx_free(void);
+void uart_flush(void);
+uint16_t uart_tx_dropped(void);
+
+#endif /* __UART_H__ */
+
+/*--------- EOF ---------*/
@@ -56,6 +56,7 @@
 /*--------- Register Macros ---------*/
 
 #define set_reg(reg, mask, value) reg = ((reg) | (value & mask))
+#define set_2byte_reg(val, reg) reg ## H = (val >> 8); reg ## L = (val & 0xff);
 //#define set_mask(reg, mask, offset)	(reg |= (mask << offset))
 //#define clr_mask(reg, mask, offset)	(reg &= ~(mask << offset)) /*!< '~' is Bitwise not */
 
@@ -1,46 +1,179 @@
-#!/bin/python
+#!/usr/bin/env python3
+"""
+Wave table generator for the function generator (Gerador_funcao).
 
+Runs as part of the build (see Debug/Makefile and the project pre-build
+event) and writes a C header with the sine, triangle, sawtooth and square
+tables, e.g.:
+
+	python3 lut-gen.py -n 256 -s 1024 -b 8 -m 7 -o Gerador_funcao/Gerador_funcao/wavetables.h
+
+Triangle, sawtooth and square are band limited and stored as a set of
+tables, one per octave of the playback frequency (a mipmap). Each table is
+summed from the Fourier series of the wave, up to the last harmonic that
+stays below the Nyquist frequency over its whole octave, so the DDS engine
+picks a table when the frequency changes and never aliases. Level k holds
+the harmonics below WAVE_LEN/2^(k + 1) and is good while the phase step is
+under 2^k table points per sample, i.e. while the tuning word is below
+2^(24 - log2(WAVE_LEN) + k). The last possible level is a plain sine.
+All the levels of a wave share the same scale (set by the level with the
+highest peak), so the amplitude does not jump between octaves. -m
+keeps only the top levels to save flash, the first kept one then also
+serves the lower octaves with fewer harmonics than it could hold.
+
+Only the first quarter of the sine is stored (SINE_LEN/4 points), the DDS
+engine rebuilds the rest by mirroring the index and inverting the value. The
+quarter is sampled half a point off (at (i + 0.5)/SINE_LEN), which makes the
+mirrored index a plain bitwise not and the inverted value 255 - v exact.
+
+Every table carries guard points, so the interpolating playback can always
+read the point after the current one without wrapping the index: full tables
+repeat their first point at the end, the quarter sine is framed by the
+inverse of its first point (read going backwards from the 2nd quadrant into
+the 3rd) and a copy of its last one (read going forward into the peak).
+
+The table length must be a power of two, so the DDS engine wraps the index
+with a shift instead of a compare. Values are rounded (not truncated), so the
+tables are symmetric. Tables up to 8 bits are stored as uint8_t with the
+samples left aligned (an N bit ladder wired to the top N bits of the port),
+wider ones as uint16_t, right aligned (-b 12 for the SPI DAC, see dac.h).
+"""
+
+import argparse
 import math as m
-expr_start = "{\n"
-expr_end = "\n }"
+import os
+import sys
 
-sin_lut = expr_start
-triang_lut = expr_start
-sawtooth_lut = expr_start
+LENGTHS = (64, 128, 256, 512, 1024)
+SINE_LENGTHS = (256, 512, 1024, 2048)
 
-lut_len = 100
-sig_ampl = 255;
+# Fourier series of each wave, around its mean and over one period
+# f in [0, 1), matching the phase of the naive shapes:
+#   triangle 0 -> 1 -> 0, sawtooth 1 -> 0, square 0 then 1
+SERIES = {
+	"trgl_lut": lambda f, h: -8/m.pi**2*m.cos(2*m.pi*h*f)/h**2 if h % 2 else 0,
+	"swtt_lut": lambda f, h: 2/m.pi*m.sin(2*m.pi*h*f)/h,
+	"sqre_lut": lambda f, h: -4/m.pi*m.sin(2*m.pi*h*f)/h if h % 2 else 0,
+}
 
 def break_str(str):
 	""" break string into 80 width lines"""
-	if (len(str) % 80 < 5):
-		str += "\n"
+	lines = []
+	line = "   "
+	for v in str.split(" "):
+		if len(line) + len(v) + 1 > 80:
+			lines.append(line.rstrip())
+			line = "   "
+		line += " " + v
+	lines.append(line.rstrip())
+	return "\n".join(lines)
+
+def quantize(f, bits):
+	""" f in [0, 1] -> rounded sample, left aligned when bits <= 8 """
+	full_scale = (1 << bits) - 1
+	v = int(m.floor(f*full_scale + 0.5))
+	return v << (8 - bits) if bits < 8 else v
+
+def invert(v, bits):
+	""" value mirrored around half scale, as the DDS engine does it """
+	return (255 if bits <= 8 else (1 << bits) - 1) - v
 
-	return str;
+def gen_mips(lut_len, levels, bits):
+	""" band limited tables, levels[i] is the octave k of the i-th table """
+	tables = {}
+	for name, series in SERIES.items():
+		waves = []
+		for k in levels:
+			harmonics = range(1, (lut_len >> (k + 1)))
+			waves.append([sum(series(float(i)/lut_len, h) for h in harmonics)
+			              for i in range(0, lut_len)])
+		peak = max(abs(v) for w in waves for v in w)
+		tables[name] = []
+		for w in waves:
+			t = [quantize(0.5 + 0.5*v/peak, bits) for v in w]
+			t.append(t[0]) # Guard point
+			tables[name].append(t)
+	return tables
 
-fmt = " {v},"
-for i in range(0,lut_len):
-	f = float(i)/(lut_len);
-	#print(f);
+def gen_sine_quarter(sine_len, bits):
+	q = [quantize(0.5 + 0.5*m.sin(2*m.pi*(i + 0.5)/sine_len), bits)
+	     for i in range(0, sine_len//4)]
+	return [invert(q[0], bits)] + q + [q[-1]] # Guard points
 
-	if(i == lut_len - 1):
-		fmt = " {v}"
+def gen_c_table(out, name, length, values):
+	out.append("")
+	out.append("static const wave_t {name}[{l}] TAB_ALLOC =".format(name=name, l=length))
+	out.append("{")
+	out.append(break_str(", ".join(str(v) for v in values)))
+	out.append("};")
 
-	print("*"*int((1-f)*80))
+def gen_c_mips(out, name, levels, tables):
+	out.append("")
+	out.append("static const wave_t {name}[WAVE_MIPS][WAVE_LEN + 1] TAB_ALLOC =".format(name=name))
+	out.append("{")
+	for k, values in zip(levels, tables):
+		out.append("  {{ /* harmonics < {h} */".format(h=(len(values) - 1) >> (k + 1)))
+		out.append(break_str(", ".join(str(v) for v in values)))
+		out.append("  },")
+	out.append("};")
 
-	sin_lut += fmt.format(v=int((0.5+0.5*m.sin(2*m.pi*f))*sig_ampl))
-	triang_lut += fmt.format(v = int(sig_ampl*(f*2) if f < 0.5 else sig_ampl*((1-f)*2)))
-	sawtooth_lut += fmt.format(v = int((1-f)*sig_ampl))
+def gen_header(lut_len, sine_len, bits, mips):
+	log2 = lut_len.bit_length() - 1
+	mips = min(mips, log2 - 1) if mips else log2 - 1
+	levels = range(log2 - 1 - mips, log2 - 1)
+	out = []
+	out.append("/* Generated by lut-gen.py -n {n} -s {s} -b {b} -m {m}, do not edit. */".format(n=lut_len, s=sine_len, b=bits, m=mips))
+	out.append("")
+	out.append("#ifndef __WAVETABLES_H__")
+	out.append("#define __WAVETABLES_H__")
+	out.append("")
+	out.append("#define WAVE_LEN_LOG2 ({l})".format(l=log2))
+	out.append("#define WAVE_LEN (1 << WAVE_LEN_LOG2)")
+	out.append("#define SINE_LEN_LOG2 ({l})".format(l=sine_len.bit_length() - 1))
+	out.append("#define SINE_LEN (1 << SINE_LEN_LOG2)")
+	out.append("#define WAVE_BITS ({b})".format(b=bits))
+	out.append("#define WAVE_MIPS ({m})".format(m=mips))
+	out.append("#define WAVE_MIP_FIRST ({k}) /* Octave of the first level */".format(k=levels[0]))
+	out.append("")
+	out.append("#ifndef __ASSEMBLER__")
+	out.append("")
+	out.append("typedef {t} wave_t;".format(t="uint8_t" if bits <= 8 else "uint16_t"))
+	out.append("")
+	out.append("/* Tables only where TAB_ALLOC is defined (dds.c), others just need the sizes */")
+	out.append("#ifdef TAB_ALLOC")
+	gen_c_table(out, "sine_qlut", "SINE_LEN/4 + 2", gen_sine_quarter(sine_len, bits))
+	for name, tables in gen_mips(lut_len, levels, bits).items():
+		gen_c_mips(out, name, levels, tables)
+	out.append("")
+	out.append("#endif /* TAB_ALLOC */")
+	out.append("")
+	out.append("#endif /* __ASSEMBLER__ */")
+	out.append("")
+	out.append("#endif /* __WAVETABLES_H__ */")
+	return "\n".join(out) + "\n"
 
-	sin_lut = break_str(sin_lut);
-	triang_lut = break_str(triang_lut);
-	sawtooth_lut = break_str(sawtooth_lut);
+parser = argparse.ArgumentParser(description="Generate the wave table header")
+parser.add_argument("-n", "--points", type=int, default=256, choices=LENGTHS,
+                    help="points per table (default 256)")
+parser.add_argument("-s", "--sine-points", type=int, default=1024, choices=SINE_LENGTHS,
+                    help="points per sine period, a quarter is stored (default 1024)")
+parser.add_argument("-b", "--bits", type=int, default=8, choices=range(1, 17),
+                    metavar="{1..16}", help="bits per sample (default 8)")
+parser.add_argument("-m", "--mips", type=int, default=0,
+                    help="band limited levels to keep, the highest octaves (default all)")
+parser.add_argument("-o", "--output", help="header to write (default stdout)")
+args = parser.parse_args()
 
-sin_lut += expr_end
-triang_lut += expr_end
-sawtooth_lut += expr_end
+header = gen_header(args.points, args.sine_points, args.bits, args.mips)
 
-#print out results
-print("static const uint8_t sine_lut[LUT_LEN] PROGMEM = \n {v};".format(l=lut_len,v=sin_lut))
-print("static const uint8_t trgl_lut[LUT_LEN] PROGMEM = \n {v};".format(l=lut_len,v=triang_lut))
-print("static const uint8_t swtt_lut[LUT_LEN] PROGMEM = \n {v};".format(l=lut_len,v=sawtooth_lut))
+if args.output is None:
+	sys.stdout.write(header)
+else:
+	# Only touch the file when it changes, so make does not rebuild for nothing
+	old = None
+	if os.path.exists(args.output):
+		with open(args.output) as f:
+			old = f.read()
+	if old != header:
+		with open(args.output, "w") as f:
+			f.write(header)